@@ -0,0 +1,260 @@
+#include <dens/registry.hpp>
+#include <dens/sharded_registry.hpp>
+#include <dens/system_group.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Usage: dens_bench [entity_count...]
+// Prints results as JSON to stdout
+
+namespace {
+using namespace dens;
+
+struct position {
+	float x{}, y{}, z{};
+};
+struct velocity {
+	float x{1.0f}, y{}, z{};
+};
+struct health {
+	int value{100};
+};
+struct frozen {};
+
+struct result_t {
+	std::string_view name;
+	std::size_t entities{};
+	std::size_t ops{};
+	std::uint64_t ns{};
+};
+
+struct sys_data {
+	float dt{};
+};
+
+std::uint64_t g_checksum{};
+
+class integrate_system : public system<sys_data> {
+	void update(registry const& reg) override {
+		for (auto [e, c] : reg.view<position, velocity>(exclude<frozen>())) {
+			auto& [p, v] = c;
+			p.x += v.x * data().dt;
+		}
+	}
+};
+
+class health_system : public system<sys_data> {
+	void update(registry const& reg) override {
+		for (auto [e, c] : reg.view<health>()) { g_checksum += static_cast<std::uint64_t>(std::get<health&>(c).value); }
+	}
+};
+
+class bench {
+  public:
+	explicit bench(std::size_t count) : m_count(count) {}
+
+	template <typename F>
+	void run(std::string_view name, F f) {
+		run(name, [](registry&, std::vector<entity>&) { return 0; }, [&f](registry& reg, std::vector<entity>& entities, int) { return f(reg, entities); });
+	}
+	///
+	/// \brief Time f(reg, entities, prepare(reg, entities)), excluding the call to prepare
+	///
+	template <typename P, typename F>
+	void run(std::string_view name, P prepare, F f) {
+		registry reg;
+		std::vector<entity> entities;
+		entities.reserve(m_count);
+		m_setup(reg, entities, m_count);
+		auto prepared = prepare(reg, entities);
+		auto const start = std::chrono::steady_clock::now();
+		std::size_t const ops = f(reg, entities, prepared);
+		auto const elapsed = std::chrono::steady_clock::now() - start;
+		m_results.push_back({name, m_count, ops, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())});
+	}
+
+	template <typename F>
+	bench& setup(F f) {
+		m_setup = f;
+		return *this;
+	}
+
+	std::vector<result_t> const& results() const noexcept { return m_results; }
+
+  private:
+	using setup_t = void (*)(registry&, std::vector<entity>&, std::size_t);
+
+	std::vector<result_t> m_results;
+	setup_t m_setup = [](registry&, std::vector<entity>&, std::size_t) {};
+	std::size_t m_count{};
+};
+
+void populate(registry& reg, std::vector<entity>& out, std::size_t count) {
+	for (std::size_t i = 0; i < count; ++i) {
+		auto e = reg.make_entity<position, velocity>();
+		if (i % 2 == 0) { reg.attach<health>(e); }
+		if (i % 8 == 0) { reg.attach<frozen>(e); }
+		out.push_back(e);
+	}
+}
+
+void run_all(std::size_t count, std::vector<result_t>& out) {
+	bench b(count);
+	b.run("make_entity", [count](registry& reg, std::vector<entity>& entities) {
+		for (std::size_t i = 0; i < count; ++i) { entities.push_back(reg.make_entity()); }
+		return count;
+	});
+	b.run("make_entity<position, velocity>", [count](registry& reg, std::vector<entity>& entities) {
+		for (std::size_t i = 0; i < count; ++i) { entities.push_back(reg.make_entity<position, velocity>()); }
+		return count;
+	});
+	b.run("sharded_registry::make_entity<position, velocity>", [count](registry&, std::vector<entity>&) {
+		// one thread per shard
+		sharded_registry sharded(std::max(std::thread::hardware_concurrency(), 1U));
+		std::vector<std::thread> threads;
+		for (std::size_t s = 0; s < sharded.shard_count(); ++s) {
+			threads.emplace_back([&sharded, s, count] {
+				auto& shard = sharded.shard(s);
+				for (std::size_t i = s; i < count; i += sharded.shard_count()) { shard.make_entity<position, velocity>(); }
+			});
+		}
+		for (auto& thread : threads) { thread.join(); }
+		return sharded.size();
+	});
+	b.setup([](registry& reg, std::vector<entity>& entities, std::size_t count) {
+		for (std::size_t i = 0; i < count; ++i) { entities.push_back(reg.make_entity()); }
+	});
+	b.run("attach<position>", [](registry& reg, std::vector<entity>& entities) {
+		for (auto const e : entities) { reg.attach<position>(e); }
+		return entities.size();
+	});
+	b.run("attach<position, velocity, health>", [](registry& reg, std::vector<entity>& entities) {
+		for (auto const e : entities) { reg.attach<position, velocity, health>(e); }
+		return entities.size();
+	});
+	b.setup([](registry& reg, std::vector<entity>& entities, std::size_t count) { populate(reg, entities, count); });
+	b.run("detach<velocity>", [](registry& reg, std::vector<entity>& entities) {
+		for (auto const e : entities) { reg.detach<velocity>(e); }
+		return entities.size();
+	});
+	b.run("detach_all<velocity>", [](registry& reg, std::vector<entity>&) { return reg.detach_all<velocity>(); });
+	b.run("attach_all<frozen, position>", [](registry& reg, std::vector<entity>&) { return reg.attach_all<frozen, position>(); });
+	b.run("clone", [](registry& reg, std::vector<entity>& entities) { return reg.clone(entities.front(), entities.size()).size(); });
+	b.run("destroy", [](registry& reg, std::vector<entity>& entities) {
+		for (auto const e : entities) { reg.destroy(e); }
+		return entities.size();
+	});
+	b.run("find<health>", [](registry& reg, std::vector<entity>& entities) {
+		for (auto const e : entities) {
+			if (auto h = reg.find<health>(e)) { g_checksum += static_cast<std::uint64_t>(h->value); }
+		}
+		return entities.size();
+	});
+	b.run("get<position>", [](registry& reg, std::vector<entity>& entities) {
+		for (auto const e : entities) { g_checksum += static_cast<std::uint64_t>(reg.get<position>(e).y); }
+		return entities.size();
+	});
+	b.run(
+		"handle::get<position>",
+		[](registry& reg, std::vector<entity>& entities) {
+			std::vector<handle> handles;
+			handles.reserve(entities.size());
+			for (auto const e : entities) { handles.emplace_back(reg, e); }
+			return handles;
+		},
+		[](registry&, std::vector<entity>&, std::vector<handle>& handles) {
+			for (auto const& h : handles) { g_checksum += static_cast<std::uint64_t>(h.get<position>().y); }
+			for (auto const& h : handles) { g_checksum += static_cast<std::uint64_t>(h.get<position>().y); }
+			return 2 * handles.size();
+		});
+	b.run("view<position, velocity>", [](registry& reg, std::vector<entity>&) {
+		std::size_t ret{};
+		for (auto [e, c] : reg.view<position, velocity>()) {
+			auto& [p, v] = c;
+			p.x += v.x;
+			++ret;
+		}
+		return ret;
+	});
+	b.run("view<position, velocity>(exclude<frozen>)", [](registry& reg, std::vector<entity>&) {
+		std::size_t ret{};
+		for (auto [e, c] : reg.view<position, velocity>(exclude<frozen>())) {
+			auto& [p, v] = c;
+			p.x += v.x;
+			++ret;
+		}
+		return ret;
+	});
+	b.run("each_chunk<position, velocity>", [](registry& reg, std::vector<entity>&) {
+		std::size_t ret{};
+		reg.each_chunk<position, velocity>([&ret](std::span<entity const> entities, std::span<position> ps, std::span<velocity> vs) {
+			for (std::size_t i = 0; i < entities.size(); ++i) { ps[i].x += vs[i].x; }
+			ret += entities.size();
+		});
+		return ret;
+	});
+	b.run("each<position, velocity>", [](registry& reg, std::vector<entity>&) {
+		std::size_t ret{};
+		reg.each<position, velocity>([&ret](position& p, velocity const& v) {
+			p.x += v.x;
+			++ret;
+		});
+		return ret;
+	});
+	b.run("system_group::update", [](registry& reg, std::vector<entity>& entities) {
+		system_group<sys_data> group;
+		group.attach<integrate_system>(0);
+		group.attach<health_system>(1);
+		group.update(reg, sys_data{1.0f / 60.0f});
+		return entities.size();
+	});
+	// random access order: each registry::get<T> looks up the record and scans the archetype, handles skip both
+	b.setup([](registry& reg, std::vector<entity>& entities, std::size_t count) {
+		populate(reg, entities, count);
+		std::shuffle(entities.begin(), entities.end(), std::mt19937(42));
+	});
+	b.run("get<position> (shuffled)", [](registry& reg, std::vector<entity>& entities) {
+		for (auto const e : entities) { g_checksum += static_cast<std::uint64_t>(reg.get<position>(e).y); }
+		for (auto const e : entities) { g_checksum += static_cast<std::uint64_t>(reg.get<position>(e).y); }
+		return 2 * entities.size();
+	});
+	b.run(
+		"handle::get<position> (shuffled)",
+		[](registry& reg, std::vector<entity>& entities) {
+			std::vector<handle> handles;
+			handles.reserve(entities.size());
+			for (auto const e : entities) { handles.emplace_back(reg, e); }
+			return handles;
+		},
+		[](registry&, std::vector<entity>&, std::vector<handle>& handles) {
+			for (auto const& h : handles) { g_checksum += static_cast<std::uint64_t>(h.get<position>().y); }
+			for (auto const& h : handles) { g_checksum += static_cast<std::uint64_t>(h.get<position>().y); }
+			return 2 * handles.size();
+		});
+	out.insert(out.end(), b.results().begin(), b.results().end());
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+	std::vector<std::size_t> counts;
+	for (int i = 1; i < argc; ++i) { counts.push_back(static_cast<std::size_t>(std::strtoull(argv[i], nullptr, 10))); }
+	if (counts.empty()) { counts = {10'000, 100'000, 1'000'000}; }
+	std::vector<result_t> results;
+	for (auto const count : counts) { run_all(count, results); }
+	std::cout << "{\n  \"benchmarks\": [\n";
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		auto const& r = results[i];
+		auto const per_op = r.ops > 0 ? static_cast<double>(r.ns) / static_cast<double>(r.ops) : 0.0;
+		std::cout << "    {\"name\": \"" << r.name << "\", \"entities\": " << r.entities << ", \"ops\": " << r.ops << ", \"ns\": " << r.ns
+				  << ", \"ns_per_op\": " << per_op << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	std::cout << "  ],\n  \"checksum\": " << g_checksum << "\n}\n";
+}
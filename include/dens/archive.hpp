@@ -0,0 +1,328 @@
+#pragma once
+#include <dens/detail/mapped_file.hpp>
+#include <dens/registry.hpp>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+namespace dens {
+///
+/// \brief Components that can be saved / restored as raw bytes
+///
+template <typename T>
+concept TrivialComponent = Component<T> && std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>;
+
+///
+/// \brief Binary snapshot / restore of entire registries
+///
+/// Each archetype is written as its signature, entities, and columns (one at a time).
+/// Trivial components are written / read with a single bulk copy per column, others go through user-provided serializers.
+/// Every component type present in a registry must be added before saving / loading it.
+///
+/// Archives saved with page-aligned columns can also be mapped: trivial columns then use the file's pages in place
+/// (shared until written to, privately copied on first write), and are copied into owned storage only when they need to grow.
+///
+/// Note: component types are identified by their signs (hashes of their compiler generated names) and native byte order is used:
+/// archives are only compatible between builds from the same compiler, on platforms with the same byte order.
+///
+class archive {
+  public:
+	///
+	/// \brief Column alignment for archives intended to be mapped
+	///
+	static constexpr std::size_t page_size_v = 4096;
+
+	template <typename T>
+	using write_t = std::function<void(std::ostream&, T const&)>;
+	template <typename T>
+	using read_t = std::function<T(std::istream&)>;
+
+	///
+	/// \brief Add a trivially copyable component type (bulk copied)
+	///
+	template <TrivialComponent T>
+	archive& add();
+	///
+	/// \brief Add a component type with custom serializers
+	///
+	template <Component T>
+	archive& add(write_t<T> write, read_t<T> read);
+	///
+	/// \brief Check if T has been added
+	///
+	template <Component T>
+	bool added() const noexcept {
+		return m_entries.contains(detail::sign_t::make<T>());
+	}
+
+	///
+	/// \brief Write all entities, names, and components in reg to out
+	/// \param column_align byte alignment of each trivial column (relative to the start of out); requires out to support tellp() if > 1
+	/// \returns false if reg contains unknown component types or out failed
+	///
+	bool save(registry const& reg, std::ostream& out, std::size_t column_align = 1) const;
+	///
+	/// \brief Clear reg and restore its contents from in
+	/// \returns false (and leaves reg empty) if in is malformed or contains unknown component types
+	///
+	/// Entity IDs are preserved, registry IDs are rewritten to reg.id()
+	///
+	bool load(registry& reg, std::istream& in) const;
+	///
+	/// \brief Clear reg and restore its contents from the file at path, using trivial columns in place where aligned (and padded) as columns require
+	/// \returns false (and leaves reg empty) if path could not be mapped, or is malformed / contains unknown component types
+	///
+	/// The file must not be modified while any of reg's columns borrow its pages
+	///
+	bool map(registry& reg, char const* path) const;
+
+  private:
+	static constexpr std::uint32_t magic_v = 0x736e6564; // "dens"
+	static constexpr std::uint32_t version_v = 3;
+
+	struct entry_t {
+		void (*register_type)(detail::tarray_factory&){};
+		bool (*borrow)(detail::tarray_base&, std::byte*, std::size_t, std::shared_ptr<void>){};
+		std::function<void(detail::tarray_base const&, std::ostream&)> write;
+		std::function<bool(detail::tarray_base&, std::istream&, std::size_t)> read;
+		std::size_t align{}; // 0 for non-trivial types
+		std::size_t size{};
+	};
+
+	struct mapping_t {
+		std::shared_ptr<detail::mapped_file> file;
+		detail::mapped_buf const& buf;
+	};
+
+	template <typename T>
+	static void write_pod(std::ostream& out, T const& t) {
+		out.write(reinterpret_cast<char const*>(&t), sizeof(T));
+	}
+	template <typename T>
+	static bool read_pod(std::istream& in, T& out) {
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(&out), sizeof(T)));
+	}
+
+	// bytes between the read position of in and end (max if in is not seekable)
+	static std::uint64_t remaining(std::istream& in, std::istream::pos_type end) {
+		if (end == std::istream::pos_type(-1)) { return std::numeric_limits<std::uint64_t>::max(); }
+		auto const pos = in.tellg();
+		return pos == std::istream::pos_type(-1) || pos > end ? 0 : static_cast<std::uint64_t>(end - pos);
+	}
+
+	static std::size_t padding(std::streamoff offset, std::size_t align) noexcept {
+		return align > 1 ? (align - static_cast<std::size_t>(offset) % align) % align : 0;
+	}
+
+	entry_t const* find(detail::sign_t sign) const noexcept;
+	bool do_load(registry& reg, std::istream& in, mapping_t const* mapping) const;
+
+	detail::flat_map<detail::sign_t, entry_t, detail::sign_t::hasher> m_entries;
+};
+
+// impl
+
+template <TrivialComponent T>
+archive& archive::add() {
+	entry_t entry;
+	entry.register_type = [](detail::tarray_factory& factory) { factory.register_type<T>(); };
+	entry.borrow = [](detail::tarray_base& array, std::byte* data, std::size_t count, std::shared_ptr<void> handle) {
+		auto const t = reinterpret_cast<T*>(data);
+		if (!detail::column<T>::borrowable(t, count)) { return false; }
+		static_cast<detail::tarray<T>&>(array).m_storage.borrow(t, count, std::move(handle));
+		return true;
+	};
+	entry.write = [](detail::tarray_base const& array, std::ostream& out) {
+		auto const& vec = static_cast<detail::tarray<T> const&>(array).m_storage;
+		out.write(reinterpret_cast<char const*>(vec.data()), static_cast<std::streamsize>(vec.size() * sizeof(T)));
+	};
+	entry.read = [](detail::tarray_base& array, std::istream& in, std::size_t count) {
+		auto& vec = static_cast<detail::tarray<T>&>(array).m_storage;
+		vec.resize(count);
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(vec.data()), static_cast<std::streamsize>(count * sizeof(T))));
+	};
+	entry.align = alignof(T);
+	entry.size = sizeof(T);
+	m_entries.insert_or_assign(detail::sign_t::make<T>(), std::move(entry));
+	return *this;
+}
+
+template <Component T>
+archive& archive::add(write_t<T> write, read_t<T> read) {
+	assert(write && read);
+	entry_t entry;
+	entry.register_type = [](detail::tarray_factory& factory) { factory.register_type<T>(); };
+	entry.write = [w = std::move(write)](detail::tarray_base const& array, std::ostream& out) {
+		for (T const& t : static_cast<detail::tarray<T> const&>(array).m_storage) { w(out, t); }
+	};
+	entry.read = [r = std::move(read)](detail::tarray_base& array, std::istream& in, std::size_t count) {
+		auto& vec = static_cast<detail::tarray<T>&>(array).m_storage;
+		vec.reserve(count);
+		for (std::size_t i = 0; i < count && in; ++i) { vec.push_back(r(in)); }
+		return static_cast<bool>(in) && vec.size() == count;
+	};
+	m_entries.insert_or_assign(detail::sign_t::make<T>(), std::move(entry));
+	return *this;
+}
+
+inline archive::entry_t const* archive::find(detail::sign_t sign) const noexcept {
+	if (auto it = m_entries.find(sign); it != m_entries.end()) { return &it->second; }
+	return {};
+}
+
+inline bool archive::save(registry const& reg, std::ostream& out, std::size_t column_align) const {
+	auto const guard = reg.lock(true);
+	auto const start = out.tellp();
+	if (column_align > 1 && start == std::ostream::pos_type(-1)) { return false; }
+	std::uint64_t archetypes{};
+	for (auto const& [_, arch] : reg.m_map.m_map) {
+		if (arch->empty()) { continue; }
+		for (auto const sign : arch->id().types) {
+			if (!find(sign)) { return false; }
+		}
+		++archetypes;
+	}
+	write_pod(out, magic_v);
+	write_pod(out, version_v);
+	write_pod(out, static_cast<std::uint64_t>(column_align));
+	write_pod(out, static_cast<std::uint64_t>(reg.m_next_id.load()));
+	write_pod(out, static_cast<std::uint64_t>(reg.m_records.size()));
+	reg.m_records.for_each([&out](std::size_t id, registry::record const& rec) {
+		write_pod(out, static_cast<std::uint64_t>(id));
+		write_pod(out, static_cast<std::uint64_t>(rec.name.size()));
+		out.write(rec.name.data(), static_cast<std::streamsize>(rec.name.size()));
+	});
+	write_pod(out, archetypes);
+	for (auto const& [_, arch] : reg.m_map.m_map) {
+		if (arch->empty()) { continue; }
+		write_pod(out, static_cast<std::uint64_t>(arch->id().types.size()));
+		for (auto const sign : arch->id().types) { write_pod(out, static_cast<std::uint64_t>(sign.hash)); }
+		auto const entities = arch->entities();
+		write_pod(out, static_cast<std::uint64_t>(entities.size()));
+		out.write(reinterpret_cast<char const*>(entities.data()), static_cast<std::streamsize>(entities.size_bytes()));
+		for (auto const& array : arch->arrays()) {
+			write_pod(out, static_cast<std::uint64_t>(array->sign().hash));
+			auto const entry = find(array->sign());
+			if (entry->align > 0) {
+				for (auto pad = padding(out.tellp() - start, column_align); pad > 0; --pad) { out.put('\0'); }
+			}
+			entry->write(*array, out);
+		}
+	}
+	return static_cast<bool>(out);
+}
+
+inline bool archive::load(registry& reg, std::istream& in) const {
+	auto const guard = reg.lock();
+	reg.do_clear();
+	if (!do_load(reg, in, nullptr)) {
+		reg.do_clear();
+		return false;
+	}
+	return true;
+}
+
+inline bool archive::map(registry& reg, char const* path) const {
+	auto const guard = reg.lock();
+	reg.do_clear();
+	auto file = detail::mapped_file::open(path);
+	if (!file) { return false; }
+	detail::mapped_buf buf(file->data(), file->size());
+	std::istream in(&buf);
+	mapping_t const mapping{std::move(file), buf};
+	if (!do_load(reg, in, &mapping)) {
+		reg.do_clear();
+		return false;
+	}
+	return true;
+}
+
+inline bool archive::do_load(registry& reg, std::istream& in, mapping_t const* mapping) const {
+	auto const start = in.tellg();
+	auto end = std::istream::pos_type(-1);
+	if (start != std::istream::pos_type(-1)) {
+		end = in.rdbuf()->pubseekoff(0, std::ios_base::end, std::ios_base::in);
+		if (in.rdbuf()->pubseekpos(start, std::ios_base::in) != start) { return false; }
+	}
+	std::uint32_t magic{}, version{};
+	if (!read_pod(in, magic) || !read_pod(in, version) || magic != magic_v || version != version_v) { return false; }
+	std::uint64_t column_align{};
+	if (!read_pod(in, column_align) || (column_align > 1 && start == std::istream::pos_type(-1))) { return false; }
+	std::uint64_t next_id{}, count{};
+	if (!read_pod(in, next_id) || !read_pod(in, count)) { return false; }
+	reg.m_next_id.store(static_cast<std::size_t>(next_id));
+	for (std::uint64_t i = 0; i < count; ++i) {
+		std::uint64_t id{}, length{};
+		if (!read_pod(in, id) || !read_pod(in, length)) { return false; }
+		if (id == entity::null_id || id > next_id || reg.m_records.find(static_cast<std::size_t>(id))) { return false; }
+		if (length > 0 && length > remaining(in, end)) { return false; }
+		// read in bounded steps: length is unchecked if in is not seekable
+		std::string name;
+		while (name.size() < length) {
+			auto const offset = name.size();
+			name.resize(offset + std::min(static_cast<std::size_t>(length - offset), std::size_t(4096)));
+			if (!in.read(name.data() + offset, static_cast<std::streamsize>(name.size() - offset))) { return false; }
+		}
+		reg.m_records.emplace(static_cast<std::size_t>(id), registry::record{std::move(name)});
+	}
+	if (!read_pod(in, count)) { return false; }
+	std::uint64_t unplaced = reg.m_records.size();
+	std::vector<detail::sign_t> signs, filled;
+	for (std::uint64_t a = 0; a < count; ++a) {
+		std::uint64_t types{}, rows{};
+		if (!read_pod(in, types) || types == 0 || types > m_entries.size()) { return false; }
+		signs.clear();
+		for (std::uint64_t t = 0; t < types; ++t) {
+			std::uint64_t hash{};
+			if (!read_pod(in, hash)) { return false; }
+			auto const sign = detail::sign_t{static_cast<std::size_t>(hash)};
+			auto const entry = find(sign);
+			if (!entry || std::find(signs.begin(), signs.end(), sign) != signs.end()) { return false; }
+			entry->register_type(reg.m_map.m_factory);
+			signs.push_back(sign);
+		}
+		if (!read_pod(in, rows) || rows > unplaced || rows * sizeof(entity) > remaining(in, end)) { return false; }
+		unplaced -= rows;
+		detail::archetype& arch = reg.m_map.get_or_make(signs);
+		if (!arch.empty()) { return false; }
+		auto const entities = arch.prepare_rows(static_cast<std::size_t>(rows));
+		if (!in.read(reinterpret_cast<char*>(entities.data()), static_cast<std::streamsize>(entities.size_bytes()))) { return false; }
+		for (std::size_t index = 0; index < entities.size(); ++index) {
+			auto& e = entities[index];
+			e.registry_id = reg.m_id;
+			auto rec = reg.m_records.find_mut(e.id);
+			if (!rec || rec->arch) { return false; }
+			rec->arch = &arch;
+			rec->index = index;
+		}
+		// each column exactly once: types distinct signs of arch fill all its columns
+		filled.clear();
+		for (std::uint64_t t = 0; t < types; ++t) {
+			std::uint64_t hash{};
+			if (!read_pod(in, hash)) { return false; }
+			auto const sign = detail::sign_t{static_cast<std::size_t>(hash)};
+			auto const array = arch.find_base(sign);
+			auto const entry = find(sign);
+			if (!array || !entry || std::find(filled.begin(), filled.end(), sign) != filled.end()) { return false; }
+			filled.push_back(sign);
+			if (entry->align > 0) {
+				if (!in.ignore(static_cast<std::streamsize>(padding(in.tellg() - start, static_cast<std::size_t>(column_align))))) { return false; }
+				if (mapping) {
+					auto const offset = mapping->buf.offset();
+					auto const bytes = entities.size() * entry->size;
+					auto const data = mapping->file->data() + offset;
+					if (offset + bytes <= mapping->file->size() && entry->borrow(*array, data, entities.size(), mapping->file)) {
+						in.seekg(static_cast<std::streamoff>(bytes), std::ios_base::cur);
+						continue;
+					}
+				}
+			}
+			if (!entry->read(*array, in, entities.size()) || array->size() != entities.size()) { return false; }
+		}
+	}
+	return true;
+}
+} // namespace dens
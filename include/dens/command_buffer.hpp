@@ -0,0 +1,82 @@
+#pragma once
+#include <dens/registry.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dens {
+///
+/// \brief Records structural changes to apply to a registry later (eg on its owning thread)
+///
+/// Not thread-safe: use one buffer per thread / job. New entities can be obtained from any thread via
+/// registry::reserve_entity(), and recorded here via make_entity().
+///
+class command_buffer {
+  public:
+	///
+	/// \brief Record creation of reserved (obtained from registry::reserve_entity()), with Types... attached (default constructed)
+	///
+	template <Component... Types>
+	command_buffer& make_entity(entity reserved, std::string name = {}) {
+		return push([reserved, name = std::move(name)](registry& reg) mutable { reg.materialize<Types...>(reserved, std::move(name)); });
+	}
+	///
+	/// \brief Record attaching t to e
+	///
+	template <Component T>
+	command_buffer& attach(entity e, T t = T{}) {
+		return push([e, t = std::move(t)](registry& reg) mutable { reg.attach<T>(e, std::move(t)); });
+	}
+	///
+	/// \brief Record detaching Types... from e
+	///
+	template <Component... Types>
+		requires(sizeof...(Types) > 0)
+	command_buffer& detach(entity e) {
+		return push([e](registry& reg) { reg.detach<Types...>(e); });
+	}
+	///
+	/// \brief Record destroying e
+	///
+	command_buffer& destroy(entity e) {
+		return push([e](registry& reg) { reg.destroy(e); });
+	}
+
+	std::size_t size() const noexcept { return m_commands.size(); }
+	bool empty() const noexcept { return m_commands.empty(); }
+	void clear() noexcept { m_commands.clear(); }
+
+	///
+	/// \brief Apply all recorded commands to reg (in order of recording) and clear them
+	///
+	void apply(registry& reg);
+
+  private:
+	struct command_base {
+		virtual ~command_base() = default;
+		virtual void apply(registry& reg) = 0;
+	};
+
+	template <typename F>
+	struct command : command_base {
+		F f;
+		command(F f) : f(std::move(f)) {}
+		void apply(registry& reg) override { f(reg); }
+	};
+
+	template <typename F>
+	command_buffer& push(F f) {
+		m_commands.push_back(std::make_unique<command<F>>(std::move(f)));
+		return *this;
+	}
+
+	std::vector<std::unique_ptr<command_base>> m_commands;
+};
+
+// impl
+
+inline void command_buffer::apply(registry& reg) {
+	for (auto const& command : m_commands) { command->apply(reg); }
+	m_commands.clear();
+}
+} // namespace dens
@@ -0,0 +1,189 @@
+#pragma once
+#include <dens/command_buffer.hpp>
+#include <dens/system.hpp>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <utility>
+
+namespace dens {
+namespace detail {
+///
+/// \brief Base type of awaitables that suspend a coro_system until a condition holds
+///
+struct coro_wait {
+	///
+	/// \brief Polled once per update of the suspended system
+	///
+	virtual bool ready() noexcept = 0;
+
+  protected:
+	~coro_wait() = default;
+};
+} // namespace detail
+
+///
+/// \brief Coroutine type returned by coro_system::run()
+///
+/// Suspends initially, and at each co_await of an awaitable derived from detail::coro_wait (eg wait_frames);
+/// exceptions escaping the coroutine terminate the program.
+///
+class system_task {
+  public:
+	struct promise_type;
+	using handle_t = std::coroutine_handle<promise_type>;
+
+	struct promise_type {
+		detail::coro_wait* wait{};
+
+		system_task get_return_object() noexcept { return system_task(handle_t::from_promise(*this)); }
+		std::suspend_always initial_suspend() const noexcept { return {}; }
+		std::suspend_always final_suspend() const noexcept { return {}; }
+		void return_void() const noexcept {}
+		void unhandled_exception() const noexcept { std::terminate(); }
+	};
+
+	system_task() = default;
+	system_task(system_task&& rhs) noexcept : m_handle(std::exchange(rhs.m_handle, {})) {}
+	system_task& operator=(system_task&& rhs) noexcept {
+		if (&rhs != this) { system_task(std::move(rhs)).swap(*this); }
+		return *this;
+	}
+	~system_task() noexcept {
+		if (m_handle) { m_handle.destroy(); }
+	}
+
+	bool valid() const noexcept { return static_cast<bool>(m_handle); }
+	bool done() const noexcept { return !m_handle || m_handle.done(); }
+	explicit operator bool() const noexcept { return valid(); }
+
+	///
+	/// \brief Resume the coroutine if it is not done and the awaited condition (if any) holds
+	/// \returns true if resumed
+	///
+	bool resume();
+
+	void swap(system_task& rhs) noexcept { std::swap(m_handle, rhs.m_handle); }
+
+  private:
+	explicit system_task(handle_t handle) noexcept : m_handle(handle) {}
+
+	handle_t m_handle{};
+};
+
+///
+/// \brief Base class template for systems whose update is a coroutine that may suspend across frames
+///
+/// Each update resumes the current run() (starting a new one if the previous has completed) if the condition it awaits holds.
+/// The run body executes only within update(), so data() is valid there; but Data references must not be held across a co_await.
+/// The registry passed to run() is used by the run until it completes: every update in between must pass the same registry.
+///
+template <typename Data = nodata>
+class coro_system : public system<Data> {
+  public:
+	using system<Data>::update;
+
+	///
+	/// \brief Check if a run is in progress (suspended)
+	///
+	bool running() const noexcept { return m_task.valid(); }
+	///
+	/// \brief Abandon the run in progress (if any); the next update starts a new one
+	///
+	void restart() noexcept {
+		m_task = {};
+		m_registry = {};
+	}
+
+  protected:
+	///
+	/// \brief Customization point: coroutine body (use co_await, and optionally co_return)
+	///
+	virtual system_task run(registry const& reg) = 0;
+
+  private:
+	void update(registry const& reg) final;
+
+	system_task m_task;
+	registry const* m_registry{};
+};
+
+///
+/// \brief Awaitable: resume after frames further updates of the awaiting system
+///
+class wait_frames : public detail::coro_wait {
+  public:
+	explicit wait_frames(std::uint64_t frames = 1) noexcept : m_frames(frames) {}
+
+	bool ready() noexcept override { return m_frames == 0 || --m_frames == 0; }
+
+	bool await_ready() const noexcept { return m_frames == 0; }
+	void await_suspend(system_task::handle_t handle) noexcept { handle.promise().wait = this; }
+	void await_resume() const noexcept {}
+
+  private:
+	std::uint64_t m_frames{};
+};
+
+///
+/// \brief Awaitable: resume at the next update of the awaiting system (frame boundary)
+///
+inline wait_frames next_frame() noexcept { return wait_frames(1); }
+
+///
+/// \brief Awaitable: resume at the first update of the awaiting system where pred() returns true
+///
+template <typename Pred>
+class wait_until : public detail::coro_wait {
+  public:
+	explicit wait_until(Pred pred) : m_pred(std::move(pred)) {}
+
+	bool ready() noexcept override { return static_cast<bool>(m_pred()); }
+
+	bool await_ready() noexcept { return ready(); }
+	void await_suspend(system_task::handle_t handle) noexcept { handle.promise().wait = this; }
+	void await_resume() const noexcept {}
+
+  private:
+	Pred m_pred;
+};
+
+///
+/// \brief Awaitable: resume once sys has completed an update (after the co_await)
+///
+/// Resumes in the same frame if sys is ordered before the awaiting system, else in the next one
+///
+template <typename Data>
+auto wait_for(system<Data> const& sys) {
+	return wait_until([&sys, count = sys.update_count()] { return sys.update_count() > count; });
+}
+
+///
+/// \brief Awaitable: resume once all commands recorded in buffer have been applied (or cleared)
+///
+inline auto wait_flushed(command_buffer const& buffer) {
+	return wait_until([&buffer] { return buffer.empty(); });
+}
+
+// impl
+
+inline bool system_task::resume() {
+	if (done()) { return false; }
+	auto& promise = m_handle.promise();
+	if (promise.wait && !promise.wait->ready()) { return false; }
+	promise.wait = {};
+	m_handle.resume();
+	return true;
+}
+
+template <typename Data>
+void coro_system<Data>::update(registry const& reg) {
+	assert(!m_registry || m_registry == &reg);
+	if (!m_task) {
+		m_task = run(reg);
+		m_registry = &reg;
+	}
+	m_task.resume();
+	if (m_task.done()) { restart(); }
+}
+} // namespace dens
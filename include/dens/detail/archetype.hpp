@@ -1,18 +1,29 @@
 #pragma once
+#include <dens/detail/flat_map.hpp>
 #include <dens/detail/tarray.hpp>
 #include <dens/entity.hpp>
+#include <dens/stats.hpp>
+#include <atomic>
+#include <deque>
 #include <tuple>
 
 namespace dens::detail {
+#if defined(DENS_COUNTERS)
+inline constexpr bool counters_v = true;
+#else
+inline constexpr bool counters_v = false;
+#endif
+
 class archetype {
   public:
 	struct id_t {
-		std::vector<sign_t> types;
+		std::vector<sign_t> types; // sorted
 		sign_t combined{};
 
 		static id_t make(std::span<sign_t const> signs) {
 			id_t ret;
 			ret.types = {signs.begin(), signs.end()};
+			std::sort(ret.types.begin(), ret.types.end());
 			ret.combined = sign_t::combine(signs);
 			return ret;
 		}
@@ -35,6 +46,16 @@ class archetype {
 		};
 	};
 
+	struct frozen_t {
+		struct array_t {
+			sign_t sign{};
+			frozen_column column{};
+		};
+
+		frozen_column entities{};
+		std::vector<array_t> arrays{};
+	};
+
 	static archetype make(tarray_factory const& factory, std::span<sign_t const> signs) {
 		archetype ret;
 		ret.m_id = id_t::make(signs);
@@ -44,9 +65,15 @@ class archetype {
 	}
 
 	id_t const& id() const noexcept { return m_id; }
+	// incremented whenever existing rows are removed or reordered (appending rows leaves it unchanged)
+	std::uint64_t version() const noexcept { return m_version; }
 	std::size_t size() const noexcept { return m_arrays.empty() ? 0 : m_arrays[0]->size(); }
+	std::size_t capacity() const noexcept { return m_entities.capacity(); }
 	bool empty() const noexcept { return size() == 0; }
 
+	std::span<entity const> entities() const noexcept { return {m_entities.data(), m_entities.size()}; }
+	std::span<std::unique_ptr<tarray_base> const> arrays() const noexcept { return m_arrays; }
+
 	tarray_base* find_base(sign_t sign) const noexcept {
 		for (auto const& r : m_arrays) {
 			if (r->match(sign)) { return r.get(); }
@@ -81,10 +108,32 @@ class archetype {
 		return *found;
 	}
 
+	// T may be const qualified: const access does not unshare (copy) a frozen column
+	template <typename T>
+	std::span<T> column_span() const {
+		auto& storage = get<std::remove_const_t<T>>().m_storage;
+		if constexpr (std::is_const_v<T>) {
+			return {std::as_const(storage).data(), storage.size()};
+		} else {
+			return {storage.data(), storage.size()};
+		}
+	}
+
+	// T may be const qualified: const access does not unshare (copy) a frozen column
+	template <typename T>
+	T& element(std::size_t index) const {
+		auto& storage = get<std::remove_const_t<T>>().m_storage;
+		if constexpr (std::is_const_v<T>) {
+			return std::as_const(storage).at(index);
+		} else {
+			return storage.at(index);
+		}
+	}
+
 	template <typename... Types>
 	entity_view<Types...> at(std::size_t index) const {
 		assert(index < size());
-		return {m_entities[index], std::tie(get<Types>().m_storage.at(index)...)};
+		return {m_entities[index], std::tie(element<Types>(index)...)};
 	}
 
 	template <typename... Types>
@@ -93,32 +142,29 @@ class archetype {
 		return at<Types...>(size() - 1);
 	}
 
-	bool is_last(std::size_t index) const noexcept { return index + 1 == size(); }
-
-	entity swap_back(std::size_t index) {
-		assert(index < size() && !is_last(index));
-		std::swap(m_entities.at(index), m_entities.back());
-		for (auto& array : m_arrays) { array->swap_back(index); }
-		return m_entities.at(index);
+	// moves row at index to the back of target (destroys it if target is null), components absent in target are destroyed
+	// the last row is moved into the hole: returns its entity (or null if index was the last row)
+	// postcondition: caller must push all components in target that are absent here
+	entity migrate(std::size_t index, archetype* target) {
+		assert(index < size() && target != this);
+		++m_version;
+		for (auto& array : m_arrays) { array->migrate(index, target ? target->find_base(array->sign()) : nullptr); }
+		if (target) { target->m_entities.push_back(std::as_const(m_entities)[index]); }
+		m_entities.erase_unordered(index);
+		return index < m_entities.size() ? std::as_const(m_entities)[index] : entity{};
 	}
 
-	entity migrate_back(archetype* target) {
-		auto const ret = m_entities.back();
-		m_entities.pop_back();
-		for (auto& array : m_arrays) {
-			if (target) {
-				array->pop_push_back(target->find_base(array->sign()));
-			} else {
-				array->pop_back();
-			}
+	// moves rows [first, size()) to the back of target (destroys them if target is null), preserving their order
+	// postcondition: caller must push all components in target that are absent here
+	void migrate_tail(std::size_t first, archetype* target) {
+		assert(first <= size() && target != this);
+		++m_version;
+		for (auto& array : m_arrays) { array->migrate_tail(first, target ? target->find_base(array->sign()) : nullptr); }
+		if (target) {
+			m_entities.splice_back(first, target->m_entities);
+		} else {
+			m_entities.erase_back(first);
 		}
-		if (target) { target->m_entities.push_back(ret); }
-		return ret;
-	}
-
-	void pop_back() {
-		for (auto& array : m_arrays) { array->pop_back(); }
-		m_entities.pop_back();
 	}
 
 	// must push exactly one entity before any components
@@ -132,13 +178,86 @@ class archetype {
 	// must have pushed exactly one entity before any components
 	// postcondition: entity count must equal count of modified component
 	template <typename T, typename... Args>
-	std::vector<T>& emplace_back(Args&&... args) {
+	column<T>& emplace_back(Args&&... args) {
 		auto& vec = get<T>().m_storage;
 		vec.emplace_back(std::forward<Args>(args)...);
 		assert(m_entities.size() == vec.size());
 		return vec;
 	}
 
+	// precondition: archetype must be empty
+	// postcondition: caller must fill all entities and each array to count elements
+	std::span<entity> prepare_rows(std::size_t count) {
+		assert(m_entities.empty() && empty());
+		m_entities.resize(count);
+		return {m_entities.data(), count};
+	}
+
+	// appends a copy of the components at index for each entity in entities
+	// precondition: copyable()
+	void append_copies(std::size_t index, std::span<entity const> entities) {
+		assert(index < size());
+		for (auto& array : m_arrays) { array->append_copies(index, entities.size()); }
+		m_entities.reserve(m_entities.size() + entities.size());
+		for (auto const e : entities) { m_entities.push_back(e); }
+	}
+
+	// offsets all entity IDs and replaces their registry ID
+	void remap_entities(std::size_t id_offset, std::size_t registry_id) {
+		for (auto& e : m_entities) {
+			e.id += id_offset;
+			e.registry_id = registry_id;
+		}
+	}
+
+	void clear() noexcept {
+		++m_version;
+		for (auto& array : m_arrays) { array->clear(); }
+		m_entities.clear();
+	}
+
+	// postcondition: row i is moved from (former) row order[i]
+	void permute(std::span<std::size_t const> order) {
+		assert(order.size() == size());
+		++m_version;
+		m_entities.permute(order);
+		for (auto& array : m_arrays) { array->permute(order); }
+	}
+
+	// release memory of columns whose capacity is at least ratio times their size
+	void shrink(std::size_t ratio) {
+		if (m_entities.capacity() > m_entities.size() && m_entities.capacity() >= ratio * m_entities.size()) { m_entities.shrink_to_fit(); }
+		for (auto& array : m_arrays) { array->shrink(ratio); }
+	}
+
+	bool copyable() const noexcept {
+		for (auto const& array : m_arrays) {
+			if (!array->copyable()) { return false; }
+		}
+		return true;
+	}
+
+	// precondition: all arrays must be copyable
+	frozen_t freeze() {
+		frozen_t ret;
+		ret.entities = m_entities.freeze();
+		ret.arrays.reserve(m_arrays.size());
+		for (auto& array : m_arrays) { ret.arrays.push_back({array->sign(), array->freeze()}); }
+		return ret;
+	}
+
+	// precondition: frozen must have been obtained from an archetype with the same id
+	void thaw(frozen_t const& frozen) {
+		assert(frozen.arrays.size() == m_arrays.size());
+		++m_version;
+		m_entities.thaw(frozen.entities);
+		for (auto const& array : frozen.arrays) {
+			auto base = find_base(array.sign);
+			assert(base);
+			base->thaw(array.column);
+		}
+	}
+
 	bool contains(entity e) const noexcept {
 		for (auto const& entity : m_entities) {
 			if (entity == e) { return true; }
@@ -148,13 +267,21 @@ class archetype {
 
   private:
 	std::vector<std::unique_ptr<tarray_base>> m_arrays;
-	std::vector<entity> m_entities; // must be index-locked to m_arrays[0]
+	column<entity> m_entities; // must be index-locked to m_arrays[0]
 	id_t m_id;
+	std::uint64_t m_version{};
 };
 
+///
+/// \brief Archetypes indexed by their combined signature
+///
+/// Archetypes are pooled (chunked storage, stable addresses; erased archetypes are recycled), while the map itself
+/// stores (signature, archetype*) pairs contiguously: query-time scans walk a dense array.
+///
 class archetype_map {
   public:
 	using id_t = archetype::id_t;
+	using storage_map = flat_map<sign_t, archetype*, sign_t::hasher>;
 
 	template <typename... Types>
 	void register_types() {
@@ -164,12 +291,35 @@ class archetype_map {
 	bool registered(sign_t sign) const noexcept { return m_factory.registered(sign); }
 
 	archetype& get_or_make(std::span<sign_t const> signs) {
-		auto const id = id_t::make(signs);
-		auto& ret = m_map[id];
-		if (ret.id() == id_t{}) { ret = archetype::make(m_factory, signs); }
+		auto& ret = get_or_add(sign_t::combine(signs));
+		count(&structural_counters::lookups);
+		if (ret.id() == id_t{}) {
+			ret = archetype::make(m_factory, signs);
+			count(&structural_counters::lookup_misses);
+			count(&structural_counters::archetypes_created);
+		}
 		return ret;
 	}
 
+	// returns default constructed (pooled) archetype if combined is not present
+	archetype& get_or_add(sign_t combined) {
+		auto [it, inserted] = m_map.try_emplace(combined);
+		if (inserted) {
+			if (m_free.empty()) {
+				it->second = &m_pool.emplace_back();
+			} else {
+				it->second = m_free.back();
+				m_free.pop_back();
+			}
+		}
+		return *it->second;
+	}
+
+	// atomic: const queries may run concurrently
+	void count(std::uint64_t structural_counters::*counter, std::uint64_t value = 1) const noexcept {
+		if constexpr (counters_v) { std::atomic_ref<std::uint64_t>(m_counters.*counter).fetch_add(value, std::memory_order_relaxed); }
+	}
+
 	template <typename T>
 	archetype& copy_append(archetype const& rhs) {
 		auto signs = rhs.id().types;
@@ -179,12 +329,28 @@ class archetype_map {
 
 	template <typename... Types>
 	archetype const* find() const noexcept {
-		if (auto it = m_map.find(detail::signs_v<Types...>); it != m_map.end()) { return &it->second; }
+		if (auto it = m_map.find(sign_t::combine(detail::signs_v<Types...>)); it != m_map.end()) { return it->second; }
 		return {};
 	}
 
-	using storage_map = std::unordered_map<id_t, archetype, id_t::hasher>;
+	storage_map::iterator erase(storage_map::iterator it) {
+		*it->second = archetype{};
+		m_free.push_back(it->second);
+		return m_map.erase(it);
+	}
+
+	void clear() noexcept {
+		m_map.clear();
+		m_pool.clear();
+		m_free.clear();
+	}
+
 	storage_map m_map;
 	tarray_factory m_factory;
+	mutable structural_counters m_counters; // incremented by const queries too
+
+  private:
+	std::deque<archetype> m_pool;
+	std::vector<archetype*> m_free;
 };
 } // namespace dens::detail
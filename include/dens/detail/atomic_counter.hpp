@@ -0,0 +1,32 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+namespace dens::detail {
+///
+/// \brief Movable atomic counter; all operations are relaxed (only uniqueness of incremented values is guaranteed)
+///
+class atomic_counter {
+  public:
+	atomic_counter(std::size_t value = {}) noexcept : m_value(value) {}
+	atomic_counter(atomic_counter&& rhs) noexcept : m_value(rhs.load()) {}
+	atomic_counter& operator=(atomic_counter&& rhs) noexcept {
+		store(rhs.load());
+		return *this;
+	}
+
+	std::size_t load() const noexcept { return m_value.load(std::memory_order_relaxed); }
+	void store(std::size_t value) noexcept { m_value.store(value, std::memory_order_relaxed); }
+	///
+	/// \returns incremented value
+	///
+	std::size_t increment() noexcept { return m_value.fetch_add(1, std::memory_order_relaxed) + 1; }
+	///
+	/// \returns value before adding count
+	///
+	std::size_t add(std::size_t count) noexcept { return m_value.fetch_add(count, std::memory_order_relaxed); }
+
+  private:
+	std::atomic<std::size_t> m_value{};
+};
+} // namespace dens::detail
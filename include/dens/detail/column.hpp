@@ -0,0 +1,352 @@
+#pragma once
+#include <dens/traits.hpp>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dens::detail {
+///
+/// \brief Type-erased reference to a frozen (immutable, shared) column buffer
+///
+struct frozen_column {
+	std::shared_ptr<void> handle{};
+	void* data{};
+	std::size_t size{};
+};
+
+///
+/// \brief Contiguous storage for a component type (similar to std::vector<T>)
+///
+/// A column may borrow external memory (eg a mapped file) for trivially copyable types:
+/// elements are used in place until the column needs to grow, at which point they are copied into owned storage.
+/// Borrowed memory is kept alive through an opaque shared handle.
+///
+/// A column can also be frozen: its buffer is then shared (read-only) with the returned frozen_column,
+/// and copied into owned storage on first mutable access (copy-on-write).
+///
+/// Trivially relocatable types (see dens::trivially_relocatable) are moved around via memcpy.
+/// Owned storage is aligned to alignment_v, and its capacity is always a multiple of padding_v (see dens::column_padding).
+///
+template <typename T>
+class column {
+  public:
+	using value_type = T;
+	using iterator = T*;
+	using const_iterator = T const*;
+
+	static constexpr std::size_t alignment_v = alignof(T) > column_align_v ? alignof(T) : column_align_v;
+	static constexpr std::size_t padding_v = column_padding_v<T>;
+	static_assert(padding_v > 0);
+
+	///
+	/// \brief Check if count elements at data satisfy the alignment and padding requirements of borrow()
+	///
+	static bool borrowable(T const* data, std::size_t count) noexcept {
+		return reinterpret_cast<std::uintptr_t>(data) % alignment_v == 0 && count % padding_v == 0;
+	}
+
+	column() = default;
+	column(column&& rhs) noexcept { swap(rhs); }
+	column& operator=(column&& rhs) noexcept {
+		if (&rhs != this) { column(std::move(rhs)).swap(*this); }
+		return *this;
+	}
+	~column() noexcept { release(); }
+
+	std::size_t size() const noexcept { return m_size; }
+	std::size_t capacity() const noexcept { return m_capacity; }
+	bool empty() const noexcept { return m_size == 0; }
+	bool borrowed() const noexcept { return m_borrowed != nullptr; }
+	bool shared() const noexcept { return m_shared; }
+
+	T* data() {
+		unshare();
+		return m_data;
+	}
+	T const* data() const noexcept { return m_data; }
+	T& operator[](std::size_t index) { return data()[index]; }
+	T const& operator[](std::size_t index) const noexcept { return m_data[index]; }
+	T& at(std::size_t index) {
+		assert(index < m_size);
+		return data()[index];
+	}
+	T const& at(std::size_t index) const noexcept {
+		assert(index < m_size);
+		return m_data[index];
+	}
+	T& front() { return at(0); }
+	T const& front() const noexcept { return at(0); }
+	T& back() { return at(m_size - 1); }
+	T const& back() const noexcept { return at(m_size - 1); }
+
+	iterator begin() { return data(); }
+	iterator end() { return data() + m_size; }
+	const_iterator begin() const noexcept { return m_data; }
+	const_iterator end() const noexcept { return m_data + m_size; }
+
+	void reserve(std::size_t count) {
+		if (count > m_capacity || (borrowed() && count > 0)) { reallocate(count > m_size ? count : m_size); }
+	}
+	void shrink_to_fit() {
+		if (m_size == 0) {
+			release();
+		} else if (!borrowed() && m_capacity > padded(m_size)) {
+			reallocate(m_size);
+		}
+	}
+
+	template <typename... Args>
+	T& emplace_back(Args&&... args) {
+		if (m_size == m_capacity) {
+			// args may refer to an existing element: construct before reallocating
+			T t(std::forward<Args>(args)...);
+			reallocate(m_capacity == 0 ? 4 : m_capacity * 2);
+			return *std::construct_at(m_data + m_size++, std::move(t));
+		}
+		return *std::construct_at(data() + m_size++, std::forward<Args>(args)...);
+	}
+	void push_back(T const& t) { emplace_back(t); }
+	void push_back(T&& t) { emplace_back(std::move(t)); }
+	void pop_back() noexcept {
+		assert(m_size > 0);
+		--m_size;
+		if (!borrowed()) { std::destroy_at(m_data + m_size); }
+	}
+	///
+	/// \brief Remove element at index by moving the last element into its place (does not preserve order)
+	///
+	void erase_unordered(std::size_t index) {
+		assert(index < m_size);
+		auto const elements = data();
+		auto const last = m_size - 1;
+		if constexpr (trivially_relocatable_v<T>) {
+			if (!borrowed()) { std::destroy_at(elements + index); }
+			if (index != last) { relocate(elements + index, elements + last); }
+		} else {
+			if (index != last) { elements[index] = std::move(elements[last]); }
+			if (!borrowed()) { std::destroy_at(elements + last); }
+		}
+		--m_size;
+	}
+	///
+	/// \brief Move element at index to the back of out and erase_unordered(index)
+	///
+	void relocate_back(std::size_t index, column& out) {
+		assert(index < m_size && &out != this);
+		if constexpr (trivially_relocatable_v<T>) {
+			out.grow();
+			auto const elements = data();
+			relocate(out.m_data + out.m_size++, elements + index);
+			if (index + 1 != m_size) { relocate(elements + index, elements + m_size - 1); }
+			--m_size;
+		} else {
+			out.emplace_back(std::move(at(index)));
+			erase_unordered(index);
+		}
+	}
+	///
+	/// \brief Move elements [first, size()) to the back of out (preserving their order) and erase them
+	///
+	void splice_back(std::size_t first, column& out) {
+		assert(first <= m_size && &out != this);
+		auto const count = m_size - first;
+		if (count == 0) { return; }
+		out.grow(count);
+		auto const elements = data();
+		if constexpr (trivially_relocatable_v<T>) {
+			std::memcpy(static_cast<void*>(out.m_data + out.m_size), static_cast<void const*>(elements + first), count * sizeof(T));
+			out.m_size += count;
+			m_size = first;
+		} else {
+			for (std::size_t i = first; i < m_size; ++i) { std::construct_at(out.m_data + out.m_size++, std::move(elements[i])); }
+			erase_back(first);
+		}
+	}
+	///
+	/// \brief Append count copies of the element at index
+	///
+	void append_copies(std::size_t index, std::size_t count)
+		requires(std::is_copy_constructible_v<T>)
+	{
+		assert(index < m_size);
+		if (count == 0) { return; }
+		grow(count);
+		if constexpr (std::is_trivially_copyable_v<T>) {
+			// copy one element, then double the copied block
+			auto const first = m_data + m_size;
+			std::memcpy(static_cast<void*>(first), static_cast<void const*>(m_data + index), sizeof(T));
+			for (std::size_t copied = 1; copied < count;) {
+				auto const block = copied < count - copied ? copied : count - copied;
+				std::memcpy(static_cast<void*>(first + copied), static_cast<void const*>(first), block * sizeof(T));
+				copied += block;
+			}
+			m_size += count;
+		} else {
+			for (std::size_t i = 0; i < count; ++i) {
+				std::construct_at(m_data + m_size, std::as_const(m_data[index]));
+				++m_size;
+			}
+		}
+	}
+	///
+	/// \brief Erase elements [first, size())
+	///
+	void erase_back(std::size_t first) noexcept {
+		assert(first <= m_size);
+		while (m_size > first) { pop_back(); }
+	}
+	void resize(std::size_t count) {
+		reserve(count);
+		while (m_size < count) { emplace_back(); }
+		while (m_size > count) { pop_back(); }
+	}
+	void clear() noexcept { release(); }
+
+	///
+	/// \brief Reorder elements such that element i is moved from (former) element order[i]
+	///
+	void permute(std::span<std::size_t const> order) {
+		assert(order.size() == m_size);
+		auto const elements = data();
+		std::vector<bool> done(m_size);
+		for (std::size_t start = 0; start < m_size; ++start) {
+			if (done[start] || order[start] == start) { continue; }
+			// follow cycle starting at start
+			T t = std::move(elements[start]);
+			std::size_t i = start;
+			while (order[i] != start) {
+				done[i] = true;
+				elements[i] = std::move(elements[order[i]]);
+				i = order[i];
+			}
+			done[i] = true;
+			elements[i] = std::move(t);
+		}
+	}
+
+	///
+	/// \brief Use count elements at data in place; handle must keep data alive
+	///
+	void borrow(T* data, std::size_t count, std::shared_ptr<void> handle) noexcept
+		requires(std::is_trivially_copyable_v<T>)
+	{
+		assert(handle != nullptr && borrowable(data, count));
+		release();
+		m_data = data;
+		m_size = m_capacity = count;
+		m_borrowed = std::move(handle);
+	}
+
+	///
+	/// \brief Share current buffer (read-only) with the returned frozen_column
+	///
+	/// The buffer does not move: T& / T* obtained before freeze() must not be written through afterwards.
+	///
+	frozen_column freeze()
+		requires(std::is_copy_constructible_v<T>)
+	{
+		if (empty()) { return {}; }
+		if (!borrowed()) {
+			auto frozen = std::make_shared<column>(std::move(*this));
+			m_data = frozen->m_data;
+			m_size = m_capacity = frozen->m_size;
+			m_borrowed = std::move(frozen);
+		}
+		m_shared = true;
+		return {m_borrowed, m_data, m_size};
+	}
+
+	///
+	/// \brief Replace contents with (read-only) shared buffer in frozen
+	///
+	void thaw(frozen_column const& frozen) noexcept
+		requires(std::is_copy_constructible_v<T>)
+	{
+		release();
+		if (frozen.size == 0) { return; }
+		m_data = static_cast<T*>(frozen.data);
+		m_size = m_capacity = frozen.size;
+		m_borrowed = frozen.handle;
+		m_shared = true;
+	}
+
+	void swap(column& rhs) noexcept {
+		std::swap(m_data, rhs.m_data);
+		std::swap(m_size, rhs.m_size);
+		std::swap(m_capacity, rhs.m_capacity);
+		std::swap(m_borrowed, rhs.m_borrowed);
+		std::swap(m_shared, rhs.m_shared);
+	}
+
+  private:
+	static constexpr std::align_val_t align_v{alignment_v};
+
+	static constexpr std::size_t padded(std::size_t count) noexcept { return (count + padding_v - 1) / padding_v * padding_v; }
+
+	static void relocate(T* dst, T const* src) noexcept { std::memcpy(static_cast<void*>(dst), static_cast<void const*>(src), sizeof(T)); }
+
+	void unshare() {
+		if (m_shared) [[unlikely]] { reallocate(m_capacity); }
+	}
+
+	// ensure space for count more elements
+	void grow(std::size_t count = 1) {
+		if (m_size + count > m_capacity) {
+			auto const doubled = m_capacity == 0 ? 4 : m_capacity * 2;
+			reallocate(m_size + count > doubled ? m_size + count : doubled);
+		} else {
+			unshare();
+		}
+	}
+
+	void reallocate(std::size_t capacity) {
+		assert(capacity >= m_size);
+		capacity = padded(capacity);
+		auto data = static_cast<T*>(::operator new(capacity * sizeof(T), align_v));
+		if constexpr (std::is_trivially_copyable_v<T>) {
+			if (m_size > 0) { std::memcpy(data, m_data, m_size * sizeof(T)); }
+		} else if (borrowed()) {
+			// borrowed buffers are never modified
+			if constexpr (std::is_copy_constructible_v<T>) {
+				std::uninitialized_copy(m_data, m_data + m_size, data);
+			} else {
+				assert(false && "borrowed column of non-copyable type");
+			}
+		} else if constexpr (trivially_relocatable_v<T>) {
+			if (m_size > 0) { std::memcpy(static_cast<void*>(data), static_cast<void const*>(m_data), m_size * sizeof(T)); }
+		} else {
+			std::uninitialized_move(m_data, m_data + m_size, data);
+			std::destroy(m_data, m_data + m_size);
+		}
+		if (!borrowed() && m_data) { ::operator delete(m_data, align_v); }
+		m_borrowed.reset();
+		m_shared = false;
+		m_data = data;
+		m_capacity = capacity;
+	}
+
+	void release() noexcept {
+		if (borrowed()) {
+			m_borrowed.reset();
+		} else if (m_data) {
+			std::destroy(m_data, m_data + m_size);
+			::operator delete(m_data, align_v);
+		}
+		m_data = {};
+		m_size = m_capacity = 0;
+		m_shared = false;
+	}
+
+	T* m_data{};
+	std::size_t m_size{};
+	std::size_t m_capacity{};
+	std::shared_ptr<void> m_borrowed{};
+	bool m_shared{};
+};
+} // namespace dens::detail
@@ -0,0 +1,211 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace dens::detail {
+///
+/// \brief Hash map storing its entries contiguously (in insertion order, until an erase) plus an open-addressing index
+///
+/// The index is a power-of-two table of (entry index + 1) slots, probed linearly; erase uses backward shift (no tombstones),
+/// and moves the last entry into the vacated position. Inserting / erasing invalidates iterators and references to entries.
+///
+template <typename K, typename V, typename Hash = std::hash<K>>
+class flat_map {
+  public:
+	using key_type = K;
+	using mapped_type = V;
+	using value_type = std::pair<K, V>;
+	using iterator = typename std::vector<value_type>::iterator;
+	using const_iterator = typename std::vector<value_type>::const_iterator;
+
+	std::size_t size() const noexcept { return m_entries.size(); }
+	bool empty() const noexcept { return m_entries.empty(); }
+
+	iterator begin() noexcept { return m_entries.begin(); }
+	iterator end() noexcept { return m_entries.end(); }
+	const_iterator begin() const noexcept { return m_entries.begin(); }
+	const_iterator end() const noexcept { return m_entries.end(); }
+
+	iterator find(K const& key) noexcept { return index_iter(m_entries.begin(), key); }
+	const_iterator find(K const& key) const noexcept { return index_iter(m_entries.begin(), key); }
+	bool contains(K const& key) const noexcept { return find(key) != end(); }
+
+	V& operator[](K const& key) { return try_emplace(key).first->second; }
+	V& at(K const& key) noexcept {
+		auto const it = find(key);
+		assert(it != end());
+		return it->second;
+	}
+	V const& at(K const& key) const noexcept {
+		auto const it = find(key);
+		assert(it != end());
+		return it->second;
+	}
+
+	///
+	/// \returns iterator to entry with key and true if inserted (with value constructed from args)
+	///
+	template <typename... Args>
+	std::pair<iterator, bool> try_emplace(K const& key, Args&&... args);
+	template <typename M>
+	std::pair<iterator, bool> insert_or_assign(K const& key, M&& value);
+	///
+	/// \brief Insert entries in [first, last) whose keys are not present
+	///
+	template <typename It>
+	void insert(It first, It last);
+
+	///
+	/// \brief Erase entry at it
+	/// \returns iterator to the entry moved into its place (or end())
+	///
+	iterator erase(const_iterator it);
+	bool erase(K const& key);
+
+	void reserve(std::size_t count);
+	///
+	/// \brief Release spare entry capacity and shrink the index to fit size()
+	///
+	void shrink_to_fit();
+	///
+	/// \brief Obtain the heap memory held by entries and index
+	///
+	std::size_t bytes() const noexcept { return m_entries.capacity() * sizeof(value_type) + m_slots.capacity() * sizeof(slot_t); }
+	void clear() noexcept {
+		m_entries.clear();
+		m_slots.clear();
+	}
+
+  private:
+	using slot_t = std::uint32_t; // entry index + 1; 0 == empty
+
+	static constexpr std::size_t min_slots_v = 8;
+
+	std::size_t mask() const noexcept { return m_slots.size() - 1; }
+	std::size_t home(K const& key) const noexcept {
+		// fibonacci hashing: spread weak (eg sequential) hashes across the table
+		return static_cast<std::size_t>((static_cast<std::uint64_t>(Hash{}(key)) * 0x9e3779b97f4a7c15ULL) >> 32) & mask();
+	}
+
+	// slot index holding key, or slot count if absent
+	std::size_t probe(K const& key) const noexcept;
+	template <typename It>
+	It index_iter(It entries, K const& key) const noexcept {
+		auto const slot = probe(key);
+		if (slot == m_slots.size()) { return entries + static_cast<std::ptrdiff_t>(m_entries.size()); }
+		return entries + static_cast<std::ptrdiff_t>(m_slots[slot] - 1);
+	}
+	void place(std::size_t index);
+	void rehash(std::size_t slots);
+
+	std::vector<value_type> m_entries;
+	std::vector<slot_t> m_slots;
+};
+
+// impl
+
+template <typename K, typename V, typename Hash>
+std::size_t flat_map<K, V, Hash>::probe(K const& key) const noexcept {
+	if (m_slots.empty()) { return 0; }
+	for (auto pos = home(key);; pos = (pos + 1) & mask()) {
+		auto const slot = m_slots[pos];
+		if (slot == 0) { return m_slots.size(); }
+		if (m_entries[slot - 1].first == key) { return pos; }
+	}
+}
+
+template <typename K, typename V, typename Hash>
+void flat_map<K, V, Hash>::place(std::size_t index) {
+	auto pos = home(m_entries[index].first);
+	while (m_slots[pos] != 0) { pos = (pos + 1) & mask(); }
+	m_slots[pos] = static_cast<slot_t>(index + 1);
+}
+
+template <typename K, typename V, typename Hash>
+void flat_map<K, V, Hash>::rehash(std::size_t slots) {
+	m_slots.assign(slots, 0);
+	for (std::size_t i = 0; i < m_entries.size(); ++i) { place(i); }
+}
+
+template <typename K, typename V, typename Hash>
+void flat_map<K, V, Hash>::reserve(std::size_t count) {
+	m_entries.reserve(count);
+	// keep load factor <= 0.5
+	auto slots = m_slots.empty() ? min_slots_v : m_slots.size();
+	while (slots < count * 2) { slots *= 2; }
+	if (slots != m_slots.size()) { rehash(slots); }
+}
+
+template <typename K, typename V, typename Hash>
+void flat_map<K, V, Hash>::shrink_to_fit() {
+	m_entries.shrink_to_fit();
+	auto slots = min_slots_v;
+	while (slots < m_entries.size() * 2) { slots *= 2; }
+	if (m_entries.empty()) { slots = 0; }
+	if (slots >= m_slots.size()) { return; }
+	std::vector<slot_t>().swap(m_slots);
+	if (slots > 0) { rehash(slots); }
+}
+
+template <typename K, typename V, typename Hash>
+template <typename... Args>
+auto flat_map<K, V, Hash>::try_emplace(K const& key, Args&&... args) -> std::pair<iterator, bool> {
+	if (auto const it = find(key); it != end()) { return {it, false}; }
+	reserve(m_entries.size() + 1);
+	m_entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+	place(m_entries.size() - 1);
+	return {m_entries.end() - 1, true};
+}
+
+template <typename K, typename V, typename Hash>
+template <typename M>
+auto flat_map<K, V, Hash>::insert_or_assign(K const& key, M&& value) -> std::pair<iterator, bool> {
+	auto ret = try_emplace(key, std::forward<M>(value));
+	if (!ret.second) { ret.first->second = std::forward<M>(value); }
+	return ret;
+}
+
+template <typename K, typename V, typename Hash>
+template <typename It>
+void flat_map<K, V, Hash>::insert(It first, It last) {
+	for (; first != last; ++first) { try_emplace(first->first, first->second); }
+}
+
+template <typename K, typename V, typename Hash>
+auto flat_map<K, V, Hash>::erase(const_iterator it) -> iterator {
+	auto const index = static_cast<std::size_t>(it - m_entries.cbegin());
+	assert(index < m_entries.size());
+	auto pos = probe(m_entries[index].first);
+	assert(pos < m_slots.size());
+	// backward shift: pull subsequent entries of the probe sequence into the hole
+	m_slots[pos] = 0;
+	for (auto next = (pos + 1) & mask(); m_slots[next] != 0; next = (next + 1) & mask()) {
+		auto const target = home(m_entries[m_slots[next] - 1].first);
+		// move next into pos unless its home lies cyclically in (pos, next]
+		bool const stays = pos <= next ? (pos < target && target <= next) : (pos < target || target <= next);
+		if (stays) { continue; }
+		m_slots[pos] = m_slots[next];
+		m_slots[next] = 0;
+		pos = next;
+	}
+	auto const last = m_entries.size() - 1;
+	if (index != last) {
+		m_slots[probe(m_entries[last].first)] = static_cast<slot_t>(index + 1);
+		m_entries[index] = std::move(m_entries[last]);
+	}
+	m_entries.pop_back();
+	return m_entries.begin() + static_cast<std::ptrdiff_t>(index);
+}
+
+template <typename K, typename V, typename Hash>
+bool flat_map<K, V, Hash>::erase(K const& key) {
+	auto const it = find(key);
+	if (it == end()) { return false; }
+	erase(it);
+	return true;
+}
+} // namespace dens::detail
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <streambuf>
+
+#if defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dens::detail {
+///
+/// \brief Private (copy-on-write) read/write mapping of an entire file
+///
+/// Pages are shared with the OS page cache (and other processes mapping the same file) until written to.
+///
+class mapped_file {
+  public:
+	static std::shared_ptr<mapped_file> open(char const* path);
+
+	mapped_file(mapped_file const&) = delete;
+	mapped_file& operator=(mapped_file const&) = delete;
+	~mapped_file() noexcept;
+
+	std::byte* data() const noexcept { return m_data; }
+	std::size_t size() const noexcept { return m_size; }
+
+  private:
+	mapped_file() = default;
+
+	std::byte* m_data{};
+	std::size_t m_size{};
+};
+
+///
+/// \brief Input stream buffer over a block of memory
+///
+class mapped_buf : public std::streambuf {
+  public:
+	mapped_buf(std::byte* data, std::size_t size) noexcept {
+		auto const begin = reinterpret_cast<char*>(data);
+		setg(begin, begin, begin + size);
+	}
+
+	std::size_t offset() const noexcept { return static_cast<std::size_t>(gptr() - eback()); }
+
+  protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+		if (!(which & std::ios_base::in)) { return pos_type(off_type(-1)); }
+		off_type const size = egptr() - eback();
+		off_type const base = dir == std::ios_base::beg ? 0 : (dir == std::ios_base::cur ? gptr() - eback() : size);
+		if (base + off < 0 || base + off > size) { return pos_type(off_type(-1)); }
+		setg(eback(), eback() + base + off, egptr());
+		return pos_type(base + off);
+	}
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override { return seekoff(off_type(pos), std::ios_base::beg, which); }
+};
+
+// impl
+
+#if defined(_WIN32)
+inline std::shared_ptr<mapped_file> mapped_file::open(char const* path) {
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) { return {}; }
+	LARGE_INTEGER size{};
+	std::shared_ptr<mapped_file> ret;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		if (HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr)) {
+			if (void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0)) {
+				ret.reset(new mapped_file());
+				ret->m_data = static_cast<std::byte*>(data);
+				ret->m_size = static_cast<std::size_t>(size.QuadPart);
+			}
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+	return ret;
+}
+
+inline mapped_file::~mapped_file() noexcept {
+	if (m_data) { UnmapViewOfFile(m_data); }
+}
+#else
+inline std::shared_ptr<mapped_file> mapped_file::open(char const* path) {
+	int const fd = ::open(path, O_RDONLY);
+	if (fd < 0) { return {}; }
+	struct stat st {};
+	std::shared_ptr<mapped_file> ret;
+	if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+		auto const size = static_cast<std::size_t>(st.st_size);
+		if (void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0); data != MAP_FAILED) {
+			ret.reset(new mapped_file());
+			ret->m_data = static_cast<std::byte*>(data);
+			ret->m_size = size;
+		}
+	}
+	::close(fd);
+	return ret;
+}
+
+inline mapped_file::~mapped_file() noexcept {
+	if (m_data) { ::munmap(m_data, m_size); }
+}
+#endif
+} // namespace dens::detail
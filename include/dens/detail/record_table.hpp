@@ -0,0 +1,130 @@
+#pragma once
+#include <dens/detail/flat_map.hpp>
+#include <array>
+#include <bitset>
+#include <cassert>
+#include <memory>
+
+namespace dens::detail {
+///
+/// \brief Map of entity IDs to Ts, stored in fixed size chunks
+///
+/// Only chunks holding records are indexed (by chunk index, in a flat_map): a chunk is released along with its last record,
+/// so memory is bounded by the live chunks regardless of how many IDs have been issued.
+/// Copies of a table share all chunks; a shared chunk is copied on first mutable access.
+///
+template <typename T>
+class record_table {
+  public:
+	static constexpr std::size_t chunk_size_v = 256;
+
+	std::size_t size() const noexcept { return m_size; }
+	bool empty() const noexcept { return m_size == 0; }
+	bool contains(std::size_t id) const noexcept { return find(id) != nullptr; }
+
+	std::size_t chunk_count() const noexcept { return m_chunks.size(); }
+	std::size_t bytes() const noexcept { return chunk_count() * sizeof(chunk_t) + m_chunks.bytes(); }
+
+	T const* find(std::size_t id) const noexcept {
+		auto const it = m_chunks.find(id / chunk_size_v);
+		auto const i = id % chunk_size_v;
+		if (it != m_chunks.end() && it->second->used.test(i)) { return &it->second->slots[i]; }
+		return {};
+	}
+
+	T* find_mut(std::size_t id) {
+		auto const it = m_chunks.find(id / chunk_size_v);
+		auto const i = id % chunk_size_v;
+		if (it != m_chunks.end() && it->second->used.test(i)) { return &mut_chunk(it->second).slots[i]; }
+		return {};
+	}
+
+	T& get_mut(std::size_t id) {
+		auto ret = find_mut(id);
+		assert(ret);
+		return *ret;
+	}
+
+	///
+	/// \returns pointer to T at id and true if inserted
+	///
+	std::pair<T*, bool> emplace(std::size_t id, T t) {
+		auto& chunk = mut_chunk(m_chunks[id / chunk_size_v]);
+		auto const i = id % chunk_size_v;
+		if (chunk.used.test(i)) { return {&chunk.slots[i], false}; }
+		chunk.used.set(i);
+		chunk.slots[i] = std::move(t);
+		++m_size;
+		return {&chunk.slots[i], true};
+	}
+
+	bool erase(std::size_t id) {
+		auto const it = m_chunks.find(id / chunk_size_v);
+		auto const i = id % chunk_size_v;
+		if (it == m_chunks.end() || !it->second->used.test(i)) { return false; }
+		if (it->second->used.count() == 1) {
+			m_chunks.erase(it);
+		} else {
+			auto& chunk = mut_chunk(it->second);
+			chunk.used.reset(i);
+			chunk.slots[i] = {};
+		}
+		--m_size;
+		return true;
+	}
+
+	///
+	/// \brief Release unused index storage
+	///
+	void shrink_to_fit() { m_chunks.shrink_to_fit(); }
+
+	void clear() noexcept {
+		m_chunks.clear();
+		m_size = 0;
+	}
+
+	///
+	/// \brief Invoke f(id, T&) for each stored T (in no particular order)
+	///
+	template <typename F>
+	void for_each_mut(F&& f) {
+		for (auto& [c, ptr] : m_chunks) {
+			auto& chunk = mut_chunk(ptr);
+			for (std::size_t i = 0; i < chunk_size_v; ++i) {
+				if (chunk.used.test(i)) { f(c * chunk_size_v + i, chunk.slots[i]); }
+			}
+		}
+	}
+
+	///
+	/// \brief Invoke f(id, T const&) for each stored T (in no particular order)
+	///
+	template <typename F>
+	void for_each(F&& f) const {
+		for (auto const& [c, ptr] : m_chunks) {
+			auto const& chunk = *ptr;
+			for (std::size_t i = 0; i < chunk_size_v; ++i) {
+				if (chunk.used.test(i)) { f(c * chunk_size_v + i, chunk.slots[i]); }
+			}
+		}
+	}
+
+  private:
+	struct chunk_t {
+		std::array<T, chunk_size_v> slots{};
+		std::bitset<chunk_size_v> used{};
+	};
+
+	static chunk_t& mut_chunk(std::shared_ptr<chunk_t>& out) {
+		if (!out) {
+			out = std::make_shared<chunk_t>();
+		} else if (out.use_count() > 1) {
+			out = std::make_shared<chunk_t>(*out);
+		}
+		return *out;
+	}
+
+	flat_map<std::size_t, std::shared_ptr<chunk_t>> m_chunks; // chunk index (id / chunk_size_v) => chunk
+	std::size_t m_size{};
+};
+} // namespace dens::detail
@@ -0,0 +1,36 @@
+#pragma once
+#include <shared_mutex>
+
+namespace dens::detail {
+///
+/// \brief Scoped lock over an optional shared_mutex: locks nothing if mutex is null
+///
+/// Locking only fails on misuse (eg relocking on the same thread), which terminates.
+///
+class rw_lock {
+  public:
+	rw_lock(std::shared_mutex* mutex, bool shared) noexcept : m_mutex(mutex), m_shared(shared) {
+		if (!m_mutex) { return; }
+		if (m_shared) {
+			m_mutex->lock_shared();
+		} else {
+			m_mutex->lock();
+		}
+	}
+	rw_lock(rw_lock const&) = delete;
+	rw_lock& operator=(rw_lock const&) = delete;
+
+	~rw_lock() noexcept {
+		if (!m_mutex) { return; }
+		if (m_shared) {
+			m_mutex->unlock_shared();
+		} else {
+			m_mutex->unlock();
+		}
+	}
+
+  private:
+	std::shared_mutex* m_mutex{};
+	bool m_shared{};
+};
+} // namespace dens::detail
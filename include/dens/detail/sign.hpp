@@ -1,35 +1,117 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <compare>
 #include <cstdint>
 #include <span>
-#include <typeinfo>
+#include <string_view>
 
 namespace dens::detail {
+// compiler generated signature of this function, which contains the name of T
+template <typename T>
+constexpr std::string_view type_signature() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+	return __FUNCSIG__;
+#else
+	return __PRETTY_FUNCTION__;
+#endif
+}
+
+// (demangled) name of T, extracted from type_signature<T>()
+template <typename T>
+constexpr std::string_view type_name() noexcept {
+	auto const sig = type_signature<T>();
+#if defined(_MSC_VER) && !defined(__clang__)
+	// "... type_signature<struct X>(void) noexcept"
+	constexpr std::string_view open_v = "type_signature<";
+	auto const first = sig.find(open_v) + open_v.size();
+	auto ret = sig.substr(first, sig.rfind(">(void)") - first);
+	for (std::string_view const prefix : {"struct ", "class ", "enum ", "union "}) {
+		if (ret.starts_with(prefix)) { ret.remove_prefix(prefix.size()); }
+	}
+	return ret;
+#else
+	// gcc: "... [with T = X; std::string_view = ...]", clang: "... [T = X]"
+	constexpr std::string_view open_v = "T = ";
+	auto const first = sig.find(open_v) + open_v.size();
+	auto last = sig.find("; ", first);
+	if (last == std::string_view::npos) { last = sig.rfind(']'); }
+	return sig.substr(first, last - first);
+#endif
+}
+
+// 64-bit FNV-1a
+constexpr std::uint64_t fnv1a(std::string_view str) noexcept {
+	std::uint64_t ret = 0xcbf29ce484222325ULL;
+	for (char const c : str) {
+		ret ^= static_cast<unsigned char>(c);
+		ret *= 0x100000001b3ULL;
+	}
+	return ret;
+}
+
+///
+/// \brief Type ID: hash of the (compiler generated) name of a type, computed at compile time
+///
 struct sign_t {
 	std::size_t hash{};
 
-	bool operator==(sign_t const& rhs) const = default;
-	operator std::size_t() const noexcept { return hash; }
+	constexpr bool operator==(sign_t const& rhs) const = default;
+	constexpr auto operator<=>(sign_t const& rhs) const = default;
+	constexpr operator std::size_t() const noexcept { return hash; }
 
-	void add_type(sign_t rhs) noexcept { hash ^= rhs.hash; }
+	constexpr void add_type(sign_t rhs) noexcept { hash ^= rhs.hash; }
 
 	struct hasher {
 		std::size_t operator()(sign_t const& s) const noexcept { return s.hash; }
 	};
 
 	template <typename T>
-	static sign_t make() noexcept {
-		static std::size_t const ret = typeid(T).hash_code();
-		return {ret};
-	}
+	static constexpr sign_t make() noexcept;
 
-	static sign_t combine(std::span<sign_t const> types) noexcept {
+	static constexpr sign_t combine(std::span<sign_t const> types) noexcept {
 		sign_t ret{};
 		for (auto const sign : types) { ret.hash ^= sign.hash; }
 		return ret;
 	}
 };
 
+// constant initialized: never hashed at runtime
+template <typename T>
+inline constexpr sign_t sign_v = {static_cast<std::size_t>(fnv1a(type_signature<T>()))};
+
+template <typename T>
+constexpr sign_t sign_t::make() noexcept {
+	return sign_v<T>;
+}
+
 template <typename... Types>
 	requires(sizeof...(Types) > 0)
-sign_t const signs_v[sizeof...(Types)] = {sign_t::make<Types>()...};
+inline constexpr sign_t signs_v[sizeof...(Types)] = {sign_t::make<Types>()...};
+
+///
+/// \brief Signs of Types... in ascending order
+///
+template <typename... Types>
+inline constexpr std::array<sign_t, sizeof...(Types)> sorted_signs_v = [] {
+	std::array<sign_t, sizeof...(Types)> ret = {sign_t::make<Types>()...};
+	std::sort(ret.begin(), ret.end());
+	return ret;
+}();
+
+///
+/// \brief Check if sorted ranges lhs and rhs have no elements in common
+///
+constexpr bool disjoint(std::span<sign_t const> lhs, std::span<sign_t const> rhs) noexcept {
+	for (auto l = lhs.begin(), r = rhs.begin(); l != lhs.end() && r != rhs.end();) {
+		if (*l < *r) {
+			++l;
+		} else if (*r < *l) {
+			++r;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
 } // namespace dens::detail
@@ -1,8 +1,10 @@
 #pragma once
+#include <dens/detail/column.hpp>
+#include <dens/detail/flat_map.hpp>
 #include <dens/detail/sign.hpp>
 #include <cassert>
 #include <memory>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 namespace dens::detail {
@@ -14,10 +16,22 @@ class tarray_base {
 	bool match(sign_t s) const noexcept { return sign() == s; }
 
 	virtual std::size_t size() const noexcept = 0;
-	virtual void swap_back(std::size_t index) = 0;
-	virtual void move_back(void* ptr) = 0;
-	virtual void pop_back() = 0;
-	virtual void pop_push_back(tarray_base* out) = 0;
+	virtual std::size_t capacity() const noexcept = 0;
+	virtual std::size_t element_size() const noexcept = 0;
+	virtual bool borrowed() const noexcept = 0;
+	virtual std::string_view type_name() const noexcept = 0;
+	// moves element at index to the back of out (erases it if out is null), fills the hole with the last element
+	virtual void migrate(std::size_t index, tarray_base* out) = 0;
+	// moves elements [first, size()) to the back of out (erases them if out is null)
+	virtual void migrate_tail(std::size_t first, tarray_base* out) = 0;
+	// precondition: copyable()
+	virtual void append_copies(std::size_t index, std::size_t count) = 0;
+	virtual void clear() noexcept = 0;
+	virtual void shrink(std::size_t ratio) = 0;
+	virtual void permute(std::span<std::size_t const> order) = 0;
+	virtual bool copyable() const noexcept = 0;
+	virtual frozen_column freeze() = 0;
+	virtual void thaw(frozen_column const& frozen) = 0;
 
   protected:
 	tarray_base(sign_t s) noexcept : m_sign(s) {}
@@ -31,34 +45,63 @@ class tarray : public tarray_base {
 	tarray() noexcept : tarray_base(sign_t::make<T>()) {}
 
 	std::size_t size() const noexcept override { return m_storage.size(); }
-	void swap_back(std::size_t index) override {
-		if (index + 1 < m_storage.size()) { std::swap(m_storage[index], m_storage.back()); }
-	}
-	void move_back(void* ptr) override {
-		auto t = reinterpret_cast<T*>(ptr);
-		m_storage.push_back(std::move(*t));
-	}
-	void pop_back() override {
-		assert(!m_storage.empty());
-		m_storage.pop_back();
+	std::size_t capacity() const noexcept override { return m_storage.capacity(); }
+	std::size_t element_size() const noexcept override { return sizeof(T); }
+	bool borrowed() const noexcept override { return m_storage.borrowed(); }
+	std::string_view type_name() const noexcept override { return detail::type_name<T>(); }
+	void migrate(std::size_t index, tarray_base* out) override {
+		if (out) {
+			assert(sign() == out->sign());
+			m_storage.relocate_back(index, static_cast<tarray<T>*>(out)->m_storage);
+		} else {
+			m_storage.erase_unordered(index);
+		}
 	}
-	void pop_push_back(tarray_base* out) override {
-		assert(!m_storage.empty());
+	void migrate_tail(std::size_t first, tarray_base* out) override {
 		if (out) {
 			assert(sign() == out->sign());
-			out->move_back(&m_storage.back());
+			m_storage.splice_back(first, static_cast<tarray<T>*>(out)->m_storage);
+		} else {
+			m_storage.erase_back(first);
+		}
+	}
+	void append_copies(std::size_t index, std::size_t count) override {
+		if constexpr (std::is_copy_constructible_v<T>) {
+			m_storage.append_copies(index, count);
+		} else {
+			assert(false && "cannot copy non-copyable type");
+		}
+	}
+	void clear() noexcept override { m_storage.clear(); }
+	void shrink(std::size_t ratio) override {
+		if (m_storage.capacity() > m_storage.size() && m_storage.capacity() >= ratio * m_storage.size()) { m_storage.shrink_to_fit(); }
+	}
+	void permute(std::span<std::size_t const> order) override { m_storage.permute(order); }
+	bool copyable() const noexcept override { return std::is_copy_constructible_v<T>; }
+	frozen_column freeze() override {
+		if constexpr (std::is_copy_constructible_v<T>) {
+			return m_storage.freeze();
+		} else {
+			assert(false && "cannot freeze non-copyable type");
+			return {};
+		}
+	}
+	void thaw(frozen_column const& frozen) override {
+		if constexpr (std::is_copy_constructible_v<T>) {
+			m_storage.thaw(frozen);
+		} else {
+			assert(false && "cannot thaw non-copyable type");
 		}
-		m_storage.pop_back();
 	}
 
-	std::vector<T> m_storage;
+	column<T> m_storage;
 };
 
 class tarray_factory {
   public:
 	template <typename T>
 	sign_t register_type() {
-		static auto const ret = sign_t::make<T>();
+		constexpr auto ret = sign_t::make<T>();
 		if (!registered(ret)) {
 			m_map[ret] = []() -> std::unique_ptr<tarray_base> { return std::make_unique<tarray<T>>(); };
 		}
@@ -67,6 +110,9 @@ class tarray_factory {
 
 	bool registered(sign_t sign) const noexcept { return m_map.contains(sign); }
 
+	// register all types registered in rhs
+	void merge(tarray_factory const& rhs) { m_map.insert(rhs.m_map.begin(), rhs.m_map.end()); }
+
 	std::unique_ptr<tarray_base> make_tarray(sign_t type) const {
 		auto it = m_map.find(type);
 		assert(it != m_map.end() && it->second != nullptr);
@@ -75,6 +121,6 @@ class tarray_factory {
 
   private:
 	using make_tarray_t = std::unique_ptr<tarray_base> (*)();
-	std::unordered_map<sign_t, make_tarray_t, sign_t::hasher> m_map;
+	flat_map<sign_t, make_tarray_t, sign_t::hasher> m_map;
 };
 } // namespace dens::detail
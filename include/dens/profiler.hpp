@@ -0,0 +1,183 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace dens {
+///
+/// \brief Customization point for receiving timings of system updates
+///
+/// Attached to a system_group via set_profiler(); nested groups without their own profiler use their parent's
+///
+class profiler {
+  public:
+	using clock_t = std::chrono::steady_clock;
+
+	struct event_t {
+		std::string_view name{};
+		clock_t::time_point start{};
+		clock_t::duration duration{};
+		std::thread::id thread{};
+		///
+		/// \brief Nesting level (0 for systems directly attached to the outermost profiled group)
+		///
+		std::uint32_t depth{};
+	};
+
+	///
+	/// \brief RAII timer for one system update; records an event on destruction
+	///
+	class scope;
+
+	virtual ~profiler() = default;
+
+	///
+	/// \brief Obtain the profiler of the innermost active scope on this thread (if any)
+	///
+	static profiler* current() noexcept { return s_current; }
+
+	///
+	/// \brief Customization point: called once per completed system update, possibly from multiple threads
+	///
+	virtual void record(event_t const& event) = 0;
+
+  private:
+	inline static thread_local profiler* s_current{};
+	inline static thread_local std::uint32_t s_depth{};
+};
+
+class profiler::scope {
+  public:
+	scope(profiler& out, std::string_view name) noexcept
+		: m_out(out), m_prev(s_current), m_name(name), m_start(clock_t::now()), m_depth(s_depth++) {
+		s_current = &m_out;
+	}
+	scope(scope const&) = delete;
+	scope& operator=(scope const&) = delete;
+
+	~scope() {
+		auto const end = clock_t::now();
+		s_current = m_prev;
+		--s_depth;
+		m_out.record({m_name, m_start, end - m_start, std::this_thread::get_id(), m_depth});
+	}
+
+  private:
+	profiler& m_out;
+	profiler* m_prev{};
+	std::string_view m_name{};
+	clock_t::time_point m_start{};
+	std::uint32_t m_depth{};
+};
+
+///
+/// \brief Profiler that stores the last capacity events in a ring buffer
+///
+class trace_buffer : public profiler {
+  public:
+	explicit trace_buffer(std::size_t capacity = 4096) : m_capacity(capacity > 0 ? capacity : 1) { m_events.reserve(m_capacity); }
+
+	void record(event_t const& event) override;
+
+	///
+	/// \brief Obtain all stored events, oldest first
+	///
+	std::vector<event_t> events() const;
+	std::size_t capacity() const noexcept { return m_capacity; }
+	void clear();
+
+	///
+	/// \brief Write all stored events in Chrome trace event format (JSON), loadable in chrome://tracing / Perfetto
+	///
+	void write_chrome_trace(std::ostream& out) const;
+
+  private:
+	static void write_escaped(std::ostream& out, std::string_view str);
+	// fixed point microseconds with nanosecond resolution (independent of stream precision)
+	static void write_us(std::ostream& out, clock_t::duration duration);
+
+	std::vector<event_t> m_events;
+	clock_t::time_point m_epoch = clock_t::now();
+	std::size_t m_capacity{};
+	std::size_t m_next{};
+	mutable std::mutex m_mutex;
+};
+
+// impl
+
+inline void trace_buffer::record(event_t const& event) {
+	auto lock = std::scoped_lock(m_mutex);
+	if (m_events.size() < m_capacity) {
+		m_events.push_back(event);
+	} else {
+		m_events[m_next] = event;
+	}
+	m_next = (m_next + 1) % m_capacity;
+}
+
+inline std::vector<profiler::event_t> trace_buffer::events() const {
+	auto lock = std::scoped_lock(m_mutex);
+	if (m_events.size() < m_capacity) { return m_events; }
+	std::vector<event_t> ret;
+	ret.reserve(m_events.size());
+	ret.insert(ret.end(), m_events.begin() + static_cast<std::ptrdiff_t>(m_next), m_events.end());
+	ret.insert(ret.end(), m_events.begin(), m_events.begin() + static_cast<std::ptrdiff_t>(m_next));
+	return ret;
+}
+
+inline void trace_buffer::clear() {
+	auto lock = std::scoped_lock(m_mutex);
+	m_events.clear();
+	m_next = 0;
+}
+
+inline void trace_buffer::write_chrome_trace(std::ostream& out) const {
+	auto const events = this->events();
+	std::vector<std::thread::id> threads; // map thread IDs to small integers
+	auto const tid = [&threads](std::thread::id id) {
+		for (std::size_t i = 0; i < threads.size(); ++i) {
+			if (threads[i] == id) { return i; }
+		}
+		threads.push_back(id);
+		return threads.size() - 1;
+	};
+	out << "{\"traceEvents\":[";
+	for (std::size_t i = 0; i < events.size(); ++i) {
+		auto const& event = events[i];
+		if (i > 0) { out << ','; }
+		out << "\n{\"name\":\"";
+		write_escaped(out, event.name);
+		out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid(event.thread);
+		out << ",\"ts\":";
+		write_us(out, event.start - m_epoch);
+		out << ",\"dur\":";
+		write_us(out, event.duration);
+		out << ",\"args\":{\"depth\":" << event.depth << "}}";
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+inline void trace_buffer::write_us(std::ostream& out, clock_t::duration duration) {
+	auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+	auto const abs = ns < 0 ? -ns : ns;
+	char const frac[] = {static_cast<char>('0' + abs / 100 % 10), static_cast<char>('0' + abs / 10 % 10), static_cast<char>('0' + abs % 10), '\0'};
+	if (ns < 0) { out << '-'; }
+	out << abs / 1000 << '.' << frac;
+}
+
+inline void trace_buffer::write_escaped(std::ostream& out, std::string_view str) {
+	for (char const c : str) {
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			out << ' ';
+		} else {
+			out << c;
+		}
+	}
+}
+} // namespace dens
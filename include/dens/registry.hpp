@@ -1,28 +1,253 @@
 #pragma once
 #include <dens/detail/archetype.hpp>
+#include <dens/detail/atomic_counter.hpp>
+#include <dens/detail/record_table.hpp>
+#include <dens/detail/rw_lock.hpp>
+#include <dens/stats.hpp>
+#include <algorithm>
+#include <atomic>
 #include <concepts>
+#include <functional>
+#include <memory>
+#include <numeric>
 #include <string>
 
 namespace dens {
+class archive;
+class snapshot;
+class handle;
+
 ///
 /// \brief Components must be moveable values
 ///
 template <typename T>
 concept Component = !std::is_reference_v<T> && !std::is_const_v<T> && std::is_move_constructible_v<T>;
 
+///
+/// \brief Components in queries may be const qualified (read-only access)
+///
+template <typename T>
+concept QueryComponent = Component<std::remove_const_t<T>>;
+
 ///
 /// \brief Facade for building exclusion typelists
 ///
 template <Component... Types>
-struct exclude {
-	inline static detail::sign_t const signs[] = {detail::sign_t::make<Types>()...};
+struct exclude {};
+///
+/// \brief Facade for building inclusion (required component) typelists for query
+///
+template <QueryComponent... Types>
+struct include {};
+
+///
+/// \brief Facade for optional components in queries: matching archetypes need not have T attached
+///
+/// Passed to each() as T* (null if not attached) and to each_chunk() as std::span<T> (empty if not attached)
+///
+template <QueryComponent T>
+struct maybe {};
+
+namespace detail {
+template <typename T>
+struct query_arg {
+	using element_t = T;
+	using ref_t = T&;
+	static constexpr bool optional_v = false;
+};
+template <typename T>
+struct query_arg<maybe<T>> {
+	using element_t = T;
+	using ref_t = T*;
+	static constexpr bool optional_v = true;
+};
+
+template <typename T>
+using query_component_t = std::remove_const_t<typename query_arg<T>::element_t>;
+
+template <typename T>
+using query_element_t = typename query_arg<T>::element_t;
+template <typename T>
+using query_ref_t = typename query_arg<T>::ref_t;
+
+template <typename T>
+query_ref_t<T> query_row(query_element_t<T>* column, std::size_t index) noexcept {
+	if constexpr (query_arg<T>::optional_v) {
+		return column ? column + index : nullptr;
+	} else {
+		return column[index];
+	}
+}
+
+template <typename... Types>
+inline constexpr bool has_required_v = (!query_arg<Types>::optional_v || ...);
+
+template <typename... Types>
+struct type_list {};
+
+// sorts clauses (include<...>, exclude<...>, maybe<T>) into typelists
+template <typename Include, typename Exclude, typename Maybe, typename... Clauses>
+struct query_parse;
+
+template <typename... I, typename... X, typename... M>
+struct query_parse<type_list<I...>, type_list<X...>, type_list<M...>> {
+	using include_t = type_list<I...>;
+	using exclude_t = exclude<X...>;
+	// arguments passed to each() / each_chunk(): included types followed by maybe<T>s
+	using args_t = type_list<I..., maybe<M>...>;
+	static constexpr auto required = sorted_signs_v<std::remove_const_t<I>...>;
+	static constexpr auto excluded = sorted_signs_v<X...>;
+};
+template <typename... I, typename... X, typename... M, typename... T, typename... Clauses>
+struct query_parse<type_list<I...>, type_list<X...>, type_list<M...>, include<T...>, Clauses...>
+	: query_parse<type_list<I..., T...>, type_list<X...>, type_list<M...>, Clauses...> {};
+template <typename... I, typename... X, typename... M, typename... T, typename... Clauses>
+struct query_parse<type_list<I...>, type_list<X...>, type_list<M...>, exclude<T...>, Clauses...>
+	: query_parse<type_list<I...>, type_list<X..., T...>, type_list<M...>, Clauses...> {};
+template <typename... I, typename... X, typename... M, typename T, typename... Clauses>
+struct query_parse<type_list<I...>, type_list<X...>, type_list<M...>, maybe<T>, Clauses...>
+	: query_parse<type_list<I...>, type_list<X...>, type_list<M..., T>, Clauses...> {};
+
+// maps each() / each_chunk() argument types to query clauses
+template <typename T>
+struct query_clause {
+	using type = include<T>;
+};
+template <typename T>
+struct query_clause<maybe<T>> {
+	using type = maybe<T>;
+};
+template <typename T>
+using query_clause_t = typename query_clause<T>::type;
+
+constexpr bool unique(std::span<sign_t const> sorted) noexcept { return std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end(); }
+} // namespace detail
+
+
+///
+/// \brief Components accessed by a query: const qualified types are read, others are written
+///
+struct query_access {
+	std::vector<detail::sign_t> reads{};
+	std::vector<detail::sign_t> writes{};
+
+	///
+	/// \brief Obtain the access of a query over Types... (which may include maybe<T>)
+	///
+	template <typename... Types>
+	static query_access make() {
+		query_access ret;
+		(ret.add(detail::sign_t::make<detail::query_component_t<Types>>(), std::is_const_v<detail::query_element_t<Types>>), ...);
+		return ret;
+	}
+
+	bool read_only() const noexcept { return writes.empty(); }
+	///
+	/// \brief Check if this and rhs may not run concurrently (either writes a component the other accesses)
+	///
+	bool conflicts(query_access const& rhs) const noexcept;
+
+  private:
+	void add(detail::sign_t sign, bool read) {
+		auto& out = read ? reads : writes;
+		if (std::find(out.begin(), out.end(), sign) == out.end()) { out.push_back(sign); }
+	}
+	static bool intersects(std::span<detail::sign_t const> lhs, std::span<detail::sign_t const> rhs) noexcept {
+		return std::find_first_of(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()) != lhs.end();
+	}
 };
+
+///
+/// \brief Compile-time query: clauses are any number of include<Types...>, exclude<Types...> and maybe<T>
 ///
-/// \brief Specialization for null typelist
+/// Signs of included and excluded types are computed and sorted at compile time; archetypes (whose signatures are also sorted)
+/// are matched via a linear merge. Queries are empty (stateless) objects: they can be stored (eg in systems) and passed to
+/// registry::view() / each() / each_chunk(), which invoke f with included types followed by maybe<T>s (in clause order).
 ///
-template <>
-struct exclude<> {
-	static constexpr std::span<detail::sign_t const> signs = {};
+template <typename... Clauses>
+class query {
+	using parse_t = detail::query_parse<detail::type_list<>, detail::type_list<>, detail::type_list<>, Clauses...>;
+
+  public:
+	using include_t = typename parse_t::include_t;
+	using exclude_t = typename parse_t::exclude_t;
+	using args_t = typename parse_t::args_t;
+
+	///
+	/// \brief Signs of all included types (ascending)
+	///
+	static constexpr auto required = parse_t::required;
+	///
+	/// \brief Signs of all excluded types (ascending)
+	///
+	static constexpr auto excluded = parse_t::excluded;
+
+	static_assert(detail::unique(required) && detail::unique(excluded), "Duplicate types (or type sign collision) in query");
+	static_assert(detail::disjoint(required, excluded), "Type both included and excluded in query");
+
+	///
+	/// \brief Check if sorted (archetype) signature types has all included types and no excluded ones
+	///
+	static constexpr bool match(std::span<detail::sign_t const> types) noexcept {
+		return !required.empty() && std::includes(types.begin(), types.end(), required.begin(), required.end()) && detail::disjoint(types, excluded);
+	}
+	///
+	/// \brief Obtain the components accessed by this query
+	///
+	static query_access access() {
+		return []<typename... Args>(detail::type_list<Args...>) { return query_access::make<Args...>(); }(args_t{});
+	}
+};
+
+///
+/// \brief Configuration for registry::compact()
+///
+struct compact_policy {
+	///
+	/// \brief Run compact() automatically after this many destroy / detach calls (0: never)
+	///
+	std::size_t interval{};
+	///
+	/// \brief Shrink columns whose capacity is at least this many times their size
+	///
+	std::size_t shrink_ratio{2};
+};
+
+///
+/// \brief Mapping of entities from a registry merged into another, to their new handles
+///
+struct entity_remap {
+	std::size_t from_registry{};
+	std::size_t to_registry{};
+	std::size_t id_offset{};
+	std::size_t max_id{};
+
+	///
+	/// \brief Check if e belonged to the merged registry
+	///
+	bool contains(entity e) const noexcept { return e.registry_id == from_registry && e.id > entity::null_id && e.id <= max_id; }
+	///
+	/// \brief Obtain the new handle for e (returns e unchanged if not contained)
+	///
+	entity operator()(entity e) const noexcept { return contains(e) ? entity{e.id + id_offset, to_registry} : e; }
+};
+
+///
+/// \brief Synchronization mode of a registry
+///
+enum class sync_mode {
+	///
+	/// \brief No internal synchronization: callers must serialize structural changes against all other access
+	///
+	none,
+	///
+	/// \brief Structural changes hold an exclusive lock; queries whose types are all const hold a shared lock
+	///
+	/// Other queries (yielding T& / T*) hold an exclusive lock while resolving columns.
+	/// Accessing components through the returned references / pointers is not synchronized, and they may dangle after a
+	/// concurrent structural change. each() / each_chunk() hold their lock while invoking f: f must not call into the registry.
+	///
+	concurrent,
 };
 
 ///
@@ -35,8 +260,10 @@ class registry {
 	///
 	inline static std::string s_name_prefix = "entity_";
 
-	registry() noexcept;
+	registry() noexcept : registry(sync_mode::none) {}
+	explicit registry(sync_mode mode);
 	std::size_t id() const noexcept { return m_id; }
+	sync_mode mode() const noexcept { return m_mutex ? sync_mode::concurrent : sync_mode::none; }
 
 	///
 	/// \brief Create a new entity, optionally with Types... components attached (default constructed)
@@ -45,9 +272,32 @@ class registry {
 	template <Component... Types>
 	entity make_entity(std::string name = {});
 	///
+	/// \brief Reserve a new entity without creating it (lock-free, may be called from any thread in any sync_mode)
+	///
+	/// The entity is not contained in this instance until it is created via materialize() or has a component attached
+	///
+	entity reserve_entity() noexcept { return entity{m_next_id.increment(), m_id}; }
+	///
+	/// \brief Create an entity obtained from reserve_entity(), optionally with Types... components attached (default constructed)
+	/// \param name name to associate with entity; set to s_name_prefix + id if empty
+	/// \returns false if reserved was not reserved by this instance, or is already contained in it
+	///
+	template <Component... Types>
+	bool materialize(entity reserved, std::string name = {});
+	///
+	/// \brief Create count copies of e, each with a copy of all of e's components
+	/// \returns new entities (empty if e is not contained or any of its components are not copy constructible)
+	///
+	/// Copies are appended to e's archetype in one pass per column (memcpy for trivially copyable components)
+	///
+	std::vector<entity> clone(entity e, std::size_t count);
+	///
 	/// \brief Check if e is owned by this instance
 	///
-	bool contains(entity e) const { return m_records.contains(e); }
+	bool contains(entity e) const {
+		auto const guard = lock(true);
+		return find_record(e) != nullptr;
+	}
 	///
 	/// \brief Destroy all components attached to e
 	/// \returns true if entity was contained in this instance
@@ -65,29 +315,91 @@ class registry {
 	///
 	/// \brief Obtain the total entity count
 	///
-	std::size_t size() const noexcept { return m_records.size(); }
+	std::size_t size() const noexcept {
+		auto const guard = lock(true);
+		return m_records.size();
+	}
 	///
 	/// \brief Check if any entities are owned by this instance
 	///
 	/// Note: instance may have archetypes and still be empty
 	///
-	bool empty() const noexcept { return m_records.empty(); }
+	bool empty() const noexcept {
+		auto const guard = lock(true);
+		return m_records.empty();
+	}
 	///
 	/// \brief Destroy all entities and stored archetypes
 	///
 	void clear() noexcept;
+	///
+	/// \brief Erase empty archetypes, shrink oversized columns, and release unused record storage
+	/// \returns number of archetypes erased
+	///
+	/// Views obtained before compacting are invalidated if any columns are shrunk
+	///
+	std::size_t compact();
+	///
+	/// \brief Set the policy used by compact(), and for compacting automatically
+	///
+	void set_compact_policy(compact_policy policy) noexcept { m_compact = policy; }
+	compact_policy const& get_compact_policy() const noexcept { return m_compact; }
+	///
+	/// \brief Move all entities and components of other into this instance, leaving other empty
+	/// \returns mapping of other's entities to their new handles
+	///
+	/// Each of other's archetypes is adopted outright if this instance has no (non-empty) matching archetype,
+	/// else its columns are appended to the matching one; entity IDs are offset in bulk. Names are preserved.
+	///
+	entity_remap merge(registry&& other);
+	///
+	/// \brief Obtain storage statistics for all archetypes and records
+	///
+	registry_stats stats() const;
+	///
+	/// \brief Obtain structural event counts since construction / last reset (always zero unless DENS_COUNTERS is defined)
+	///
+	structural_counters const& counters() const noexcept { return m_map.m_counters; }
+	///
+	/// \brief Reset all structural event counts to zero
+	///
+	void reset_counters() noexcept { m_map.m_counters = {}; }
+
+	///
+	/// \brief Take a copy-on-write snapshot of all entities and components
+	/// \returns invalid snapshot if any non-copyable components are attached
+	///
+	/// Costs O(archetypes + entities / 256): columns and chunks of records are shared with the snapshot,
+	/// and a column is copied on first mutable access (any access that yields T& / T*, or any structural change to the archetype).
+	/// References / pointers / spans to components obtained before checkpoint() alias the snapshot:
+	/// re-fetch them after the call, writing through them would modify the snapshot too.
+	///
+	snapshot checkpoint();
+	///
+	/// \brief Restore all entities and components to the state captured in snap
+	/// \returns false if snap is invalid or was not taken from this instance
+	///
+	/// Costs O(archetypes + entities / 256): columns modified since snap are released, the rest (and snap's chunks of records) are shared again
+	///
+	bool restore(snapshot const& snap);
 
 	///
 	/// \brief Attach a T to e
 	///
 	template <Component T>
-	T& attach(entity e, T t = T{});
+	T& attach(entity e, T t = T{}) {
+		auto const guard = lock();
+		return do_attach<T>(e, std::move(t));
+	}
 	///
 	/// \brief Attach multiple Types to e (default constructed)
 	///
 	template <Component... Types>
 		requires(sizeof...(Types) > 1)
-	void attach(entity e) { (attach<Types>(e), ...); }
+	void attach(entity e) {
+		auto const guard = lock();
+		(do_attach<Types>(e, Types{}), ...);
+	}
 	///
 	/// \brief Check if e has T attached
 	///
@@ -111,23 +423,127 @@ class registry {
 	///
 	template <Component... Types>
 		requires(sizeof...(Types) > 0)
-	bool detach(entity e) { return (do_detach<Types>(e) && ...); }
+	bool detach(entity e) {
+		auto const guard = lock();
+		bool const ret = (do_detach<Types>(e) && ...);
+		if (ret) { on_removed(); }
+		return ret;
+	}
+	///
+	/// \brief Attach a copy of t to all entities with Types... attached and T, Exclude... not attached
+	/// \returns number of entities T was attached to
+	///
+	/// Moves all rows of each matching archetype at once, instead of migrating one entity at a time
+	///
+	template <Component T, Component... Types, Component... Exclude>
+		requires(sizeof...(Types) > 0 && std::copy_constructible<T>)
+	std::size_t attach_all(exclude<Exclude...> = exclude<>{}, T const& t = T{});
+	///
+	/// \brief Attach a copy of t to all entities matched by attach_all() for which pred(entity_view<Types...>) returns true
+	/// \returns number of entities T was attached to
+	///
+	template <Component T, Component... Types, typename Pred, Component... Exclude>
+		requires(sizeof...(Types) > 0 && std::copy_constructible<T>)
+	std::size_t attach_if(Pred pred, exclude<Exclude...> = exclude<>{}, T const& t = T{});
+	///
+	/// \brief Detach T from all entities with T, Types... attached and Exclude... not attached
+	/// \returns number of entities T was detached from
+	///
+	/// Moves all rows of each matching archetype at once, instead of migrating one entity at a time
+	///
+	template <Component T, Component... Types, Component... Exclude>
+	std::size_t detach_all(exclude<Exclude...> = exclude<>{});
+	///
+	/// \brief Detach T from all entities matched by detach_all() for which pred(entity_view<T, Types...>) returns true
+	/// \returns number of entities T was detached from
+	///
+	template <Component T, Component... Types, typename Pred, Component... Exclude>
+	std::size_t detach_if(Pred pred, exclude<Exclude...> = exclude<>{});
 	///
 	/// \brief Obtain pointer to T if attached to e
 	///
-	template <Component T>
+	template <QueryComponent T>
 	T* find(entity e) const;
 	///
 	/// \brief Obtain reference to T if attached to e (triggers assert if not attached)
 	///
-	template <Component T>
+	template <QueryComponent T>
 	T& get(entity e) const;
 
+	///
+	/// \brief Reorder rows of all archetypes with T attached, such that their Ts are ordered by pred
+	///
+	/// All components of each row are moved together; archetypes that are already ordered are left untouched
+	///
+	template <Component T, typename Pred = std::less<>>
+	void sort(Pred pred = {});
+	///
+	/// \brief Reorder rows of all archetypes with Types... attached (all archetypes if none), such that their entities are ordered by pred
+	///
+	template <Component... Types, typename Pred = std::less<>>
+	void sort_entities(Pred pred = {});
+
 	///
 	/// \brief Obtain all entities with Types... attached and Exclude... not attached
 	///
-	template <Component... Types, Component... Exclude>
+	/// Const qualified Types are accessed read-only (as T const&). Any number of threads may concurrently run queries
+	/// (view / each / each_chunk / find / get) whose types are all const, as long as no other member function is in flight.
+	///
+	template <QueryComponent... Types, Component... Exclude>
 	std::vector<entity_view<Types...>> view(exclude<Exclude...> = exclude<>{}) const;
+	///
+	/// \brief Invoke f(std::span<entity const>, std::span<Types>...) once per non-empty archetype with Types... attached and Exclude... not attached
+	///
+	/// All spans passed to an invocation are index-locked (element i of each belongs to the same entity);
+	/// f must not attach / detach components or create / destroy entities.
+	/// Types may include maybe<T> (at least one type must not), passed as std::span<T> (empty if T is not attached).
+	///
+	template <typename... Types, typename F, Component... Exclude>
+		requires(detail::has_required_v<Types...> && std::invocable<F&, std::span<entity const>, std::span<detail::query_element_t<Types>>...>)
+	void each_chunk(F f, exclude<Exclude...> = exclude<>{}) const;
+	///
+	/// \brief Invoke f(entity, Types&...) (or f(Types&...)) for each entity with Types... attached and Exclude... not attached
+	///
+	/// Iterates raw columns of each matching archetype; f must not attach / detach components or create / destroy entities.
+	/// Types may include maybe<T> (at least one type must not), passed as T* (null if T is not attached).
+	///
+	template <typename... Types, typename F, Component... Exclude>
+		requires(detail::has_required_v<Types...> &&
+				 (std::invocable<F&, entity, detail::query_ref_t<Types>...> || std::invocable<F&, detail::query_ref_t<Types>...>))
+	void each(F f, exclude<Exclude...> = exclude<>{}) const {
+		auto const chunk = [&f](std::span<entity const> entities, std::span<detail::query_element_t<Types>>... columns) {
+			each_row<Types...>(f, entities, columns.data()...);
+		};
+		each_chunk<Types...>(chunk, exclude<Exclude...>{});
+	}
+	///
+	/// \brief Invoke f(entity, Types&...) (or f(Types&...)) for each entity with Types... attached and Exclude... not attached
+	///
+	template <typename... Types, Component... Exclude, typename F>
+		requires(detail::has_required_v<Types...> &&
+				 (std::invocable<F&, entity, detail::query_ref_t<Types>...> || std::invocable<F&, detail::query_ref_t<Types>...>))
+	void each(exclude<Exclude...> ex, F f) const {
+		each<Types...>(std::move(f), ex);
+	}
+	///
+	/// \brief Obtain all entities matching query (which must not contain maybe<T> clauses)
+	///
+	template <typename... Clauses>
+	auto view(query<Clauses...>) const;
+	///
+	/// \brief Invoke f(std::span<entity const>, std::span<Types>...) once per non-empty archetype matching query
+	///
+	/// Types are the included types followed by those of maybe<T> clauses
+	///
+	template <typename... Clauses, typename F>
+	void each_chunk(query<Clauses...>, F f) const;
+	///
+	/// \brief Invoke f(entity, Types&...) (or f(Types&...)) for each entity matching query
+	///
+	/// Types are the included types followed by those of maybe<T> clauses
+	///
+	template <typename... Clauses, typename F>
+	void each(query<Clauses...>, F f) const;
 
   private:
 	struct record {
@@ -138,72 +554,376 @@ class registry {
 
 	static std::string make_name(std::size_t id);
 
+	// shared: for queries whose types are all const
+	detail::rw_lock lock(bool shared = false) const noexcept { return {m_mutex.get(), shared}; }
+	template <typename... Types>
+	detail::rw_lock query_lock() const noexcept {
+		return lock((std::is_const_v<detail::query_element_t<Types>> && ...));
+	}
+
+	record const* find_record(entity e) const noexcept { return e.registry_id == m_id ? m_records.find(e.id) : nullptr; }
+	record* find_record(entity e) { return e.registry_id == m_id ? m_records.find_mut(e.id) : nullptr; }
 	record& get_or_make(entity e);
 	template <typename T>
 	void emplace_back(record& r, detail::archetype& arch);
+	template <Component... Types>
+	void do_make(entity e, std::string name);
+	template <Component T>
+	T& do_attach(entity e, T t);
+	template <QueryComponent T>
+	T* do_find(entity e) const;
+	void do_clear() noexcept;
+	std::size_t do_compact();
 	void migrate_to(record& out_record, detail::archetype* out_arch);
-	void send_to_back(record& r);
+	void migrate_tail(detail::archetype& arch, std::size_t first, detail::archetype* target);
+	template <Component T, Component... Types, typename F, Component... Exclude>
+	std::size_t bulk_attach(T const& t, F filter, exclude<Exclude...>);
+	template <Component T, Component... Types, typename F, Component... Exclude>
+	std::size_t bulk_detach(F filter, exclude<Exclude...>);
+	template <typename F>
+	std::size_t partition_rows(detail::archetype& arch, F pred);
 	template <typename T>
 	bool do_detach(entity e);
+	void on_removed();
+	template <typename T, typename Pred>
+	void sort_rows(detail::archetype& arch, std::span<T const> keys, Pred& pred, std::vector<std::size_t>& order);
 	template <typename... T>
 	void append(std::vector<entity_view<T...>>& out, detail::archetype const& arch) const;
+	template <typename... Types, typename F>
+	static void each_row(F& f, std::span<entity const> entities, detail::query_element_t<Types>*... columns);
+	template <typename T>
+	static std::span<detail::query_element_t<T>> query_span(detail::archetype const& arch);
 
-	inline static std::size_t s_next_id{};
+	inline static std::atomic<std::size_t> s_next_id{};
+
+	friend class archive;
+	friend class snapshot;
+	friend class handle;
 
 	detail::archetype_map m_map;
-	std::unordered_map<entity, record, entity::hasher> m_records;
-	std::size_t m_next_id{};
+	detail::record_table<record> m_records;
+	std::unique_ptr<std::shared_mutex> m_mutex;
+	compact_policy m_compact{};
+	std::size_t m_removals{};
+	std::uint64_t m_epoch{}; // incremented whenever archetypes are erased / replaced
+	detail::atomic_counter m_next_id{};
 	std::size_t m_id{};
 };
 
+///
+/// \brief Copy-on-write snapshot of a registry's entities and components
+///
+/// Shares all columns and (chunks of) records with its source registry; destroying a snapshot only releases those references
+///
+class snapshot {
+  public:
+	///
+	/// \brief Check if this instance holds a snapshot
+	///
+	bool valid() const noexcept { return m_registry_id != 0; }
+	explicit operator bool() const noexcept { return valid(); }
+	///
+	/// \brief Obtain the ID of the source registry
+	///
+	std::size_t registry_id() const noexcept { return m_registry_id; }
+	///
+	/// \brief Obtain the total entity count
+	///
+	std::size_t size() const noexcept { return m_records.size(); }
+
+  private:
+	struct archetype_t {
+		detail::archetype::id_t id;
+		detail::archetype const* arch{};
+		detail::archetype::frozen_t frozen;
+	};
+
+	std::vector<archetype_t> m_archetypes;
+	detail::record_table<registry::record> m_records;
+	std::size_t m_next_id{};
+	std::size_t m_registry_id{};
+
+	friend class registry;
+};
+
+///
+/// \brief Entity handle that caches the entity's location (archetype and row) in its registry
+///
+/// Component access costs O(1) (no record lookup) while no structural change has removed / reordered rows of the entity's archetype
+/// since the last access; otherwise the location is looked up again. Not thread-safe: use one handle per thread.
+///
+class handle {
+  public:
+	handle() = default;
+	handle(registry const& reg, entity e) noexcept : m_registry(&reg), m_entity(e) {}
+
+	struct entity entity() const noexcept { return m_entity; }
+	registry const* get_registry() const noexcept { return m_registry; }
+	bool valid() const noexcept { return m_registry != nullptr; }
+	explicit operator bool() const noexcept { return valid(); }
+
+	///
+	/// \brief Check if the entity is contained in the registry and has any components attached
+	///
+	bool has_components() const;
+	///
+	/// \brief Check if the entity has T attached
+	///
+	template <Component T>
+	bool attached() const;
+	///
+	/// \brief Obtain pointer to T if attached
+	///
+	template <QueryComponent T>
+	T* find() const;
+	///
+	/// \brief Obtain reference to T if attached (triggers assert if not attached)
+	///
+	template <QueryComponent T>
+	T& get() const;
+
+  private:
+	struct location_t {
+		detail::archetype const* arch{};
+		std::size_t index{};
+		std::uint64_t version{};
+		std::uint64_t epoch{};
+	};
+
+	bool locate() const;
+	template <typename T>
+	detail::tarray<T>* column() const;
+
+	registry const* m_registry{};
+	struct entity m_entity {};
+	mutable location_t m_location{};
+	mutable detail::tarray_base* m_column{}; // last column accessed in m_location.arch
+};
+
 // impl
 
-inline registry::registry() noexcept : m_id(++s_next_id) {}
+inline bool query_access::conflicts(query_access const& rhs) const noexcept {
+	return intersects(writes, rhs.writes) || intersects(writes, rhs.reads) || intersects(reads, rhs.writes);
+}
+
+inline registry::registry(sync_mode mode) : m_id(++s_next_id) {
+	if (mode == sync_mode::concurrent) { m_mutex = std::make_unique<std::shared_mutex>(); }
+}
 
 template <Component... Types>
 entity registry::make_entity(std::string name) {
-	auto const id = ++m_next_id;
-	if (name.empty()) { name = make_name(id); }
-	auto [it, _] = m_records.emplace(entity{id, m_id}, record{std::move(name)});
+	auto const ret = reserve_entity();
+	auto const guard = lock();
+	do_make<Types...>(ret, std::move(name));
+	return ret;
+}
+
+template <Component... Types>
+bool registry::materialize(entity reserved, std::string name) {
+	auto const guard = lock();
+	if (reserved.registry_id != m_id || reserved.id == entity::null_id || reserved.id > m_next_id.load()) { return false; }
+	if (m_records.contains(reserved.id)) { return false; }
+	do_make<Types...>(reserved, std::move(name));
+	return true;
+}
+
+template <Component... Types>
+void registry::do_make(entity e, std::string name) {
+	if (name.empty()) { name = make_name(e.id); }
+	auto [rec, _] = m_records.emplace(e.id, record{std::move(name)});
 	if constexpr (sizeof...(Types) > 0) {
 		m_map.register_types<Types...>();
 		detail::archetype& arch = m_map.get_or_make(detail::signs_v<Types...>);
-		arch.push_back(it->first);
-		(emplace_back<Types>(it->second, arch), ...);
+		arch.push_back(e);
+		(emplace_back<Types>(*rec, arch), ...);
 	}
-	return it->first;
 }
 
 inline std::string_view registry::name(entity e) const {
-	if (auto it = m_records.find(e); it != m_records.end()) { return it->second.name; }
+	auto const guard = lock(true);
+	if (auto r = find_record(e)) { return r->name; }
 	return {};
 }
 
+inline std::vector<entity> registry::clone(entity e, std::size_t count) {
+	auto const guard = lock();
+	std::vector<entity> ret;
+	auto const src = find_record(e);
+	if (!src || count == 0 || (src->arch && !src->arch->copyable())) { return ret; }
+	auto const arch = src->arch;
+	auto const index = src->index;
+	auto const first_id = m_next_id.add(count) + 1;
+	ret.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) { ret.push_back(entity{first_id + i, m_id}); }
+	std::size_t const first_row = arch ? arch->size() : 0;
+	if (arch) { arch->append_copies(index, ret); }
+	for (std::size_t i = 0; i < count; ++i) {
+		auto const id = ret[i].id;
+		m_records.emplace(id, record{make_name(id), arch, arch ? first_row + i : 0});
+	}
+	return ret;
+}
+
 inline bool registry::destroy(entity e) {
-	if (auto it = m_records.find(e); it != m_records.end()) {
-		auto& r = it->second;
-		if (r.arch) { migrate_to(r, nullptr); }
-		m_records.erase(it);
+	auto const guard = lock();
+	if (auto r = find_record(e)) {
+		if (r->arch) { migrate_to(*r, nullptr); }
+		m_records.erase(e.id);
+		on_removed();
 		return true;
 	}
 	return false;
 }
 
 inline bool registry::rename(entity e, std::string name) {
-	if (auto it = m_records.find(e); it != m_records.end()) {
-		it->second.name = std::move(name);
+	auto const guard = lock();
+	if (auto r = find_record(e)) {
+		r->name = std::move(name);
 		return true;
 	}
 	return false;
 }
 
 inline void registry::clear() noexcept {
-	m_map.m_map.clear();
+	auto const guard = lock();
+	do_clear();
+}
+
+inline std::size_t registry::compact() {
+	auto const guard = lock();
+	return do_compact();
+}
+
+inline void registry::do_clear() noexcept {
+	++m_epoch;
+	m_map.clear();
 	m_records.clear();
 }
 
+inline std::size_t registry::do_compact() {
+	m_removals = 0;
+	std::size_t ret{};
+	for (auto it = m_map.m_map.begin(); it != m_map.m_map.end();) {
+		if (it->second->empty()) {
+			it = m_map.erase(it);
+			++ret;
+			++m_epoch;
+		} else {
+			it->second->shrink(m_compact.shrink_ratio);
+			++it;
+		}
+	}
+	m_records.shrink_to_fit();
+	return ret;
+}
+
+inline void registry::on_removed() {
+	if (m_compact.interval > 0 && ++m_removals >= m_compact.interval) { do_compact(); }
+}
+
+inline entity_remap registry::merge(registry&& other) {
+	assert(&other != this);
+	// lock in ID order: concurrent a.merge(b) and b.merge(a) must not deadlock
+	auto const [lhs, rhs] = m_id < other.m_id ? std::pair<registry*, registry*>{this, &other} : std::pair<registry*, registry*>{&other, this};
+	auto const lhs_guard = lhs->lock();
+	auto const rhs_guard = rhs->lock();
+	auto const max_id = other.m_next_id.load();
+	entity_remap const ret{other.m_id, m_id, m_next_id.add(max_id), max_id};
+	++m_epoch;
+	m_map.m_factory.merge(other.m_map.m_factory);
+	struct target_t {
+		detail::archetype* arch{};
+		std::size_t first{};
+	};
+	detail::flat_map<detail::archetype const*, target_t> targets;
+	for (auto const& [id, arch] : other.m_map.m_map) {
+		if (arch->empty()) { continue; }
+		arch->remap_entities(ret.id_offset, m_id);
+		detail::archetype& target = m_map.get_or_add(id);
+		if (target.empty()) {
+			target = std::move(*arch);
+			targets[arch] = {&target, 0};
+		} else {
+			targets[arch] = {&target, target.size()};
+			m_map.count(&structural_counters::migrations, arch->size());
+			m_map.count(&structural_counters::elements_moved, arch->size() * arch->arrays().size());
+			arch->migrate_tail(0, &target);
+		}
+	}
+	other.m_records.for_each_mut([&](std::size_t id, record& rec) {
+		record out{std::move(rec.name)};
+		if (rec.arch) {
+			auto const& target = targets.at(rec.arch);
+			out.arch = target.arch;
+			out.index = target.first + rec.index;
+		}
+		m_records.emplace(id + ret.id_offset, std::move(out));
+	});
+	other.do_clear();
+	return ret;
+}
+
+inline registry_stats registry::stats() const {
+	auto const guard = lock(true);
+	registry_stats ret;
+	ret.entities = m_records.size();
+	ret.record_chunks = m_records.chunk_count();
+	ret.record_bytes = m_records.bytes();
+	ret.archetypes.reserve(m_map.m_map.size());
+	for (auto const& [id, arch] : m_map.m_map) {
+		archetype_stats as;
+		as.signature = id.hash;
+		as.rows = arch->size();
+		as.bytes = arch->capacity() * sizeof(entity);
+		as.columns.reserve(arch->arrays().size());
+		for (auto const& array : arch->arrays()) {
+			auto const bytes = array->capacity() * array->element_size();
+			as.columns.push_back({array->sign(), array->type_name(), array->size(), array->capacity(), bytes, array->borrowed()});
+			as.bytes += bytes;
+		}
+		if (arch->empty()) { ++ret.empty_archetypes; }
+		ret.archetype_bytes += as.bytes;
+		ret.archetypes.push_back(std::move(as));
+	}
+	return ret;
+}
+
+inline snapshot registry::checkpoint() {
+	auto const guard = lock();
+	for (auto const& [_, arch] : m_map.m_map) {
+		if (!arch->empty() && !arch->copyable()) { return {}; }
+	}
+	snapshot ret;
+	ret.m_archetypes.reserve(m_map.m_map.size());
+	for (auto const& [id, arch] : m_map.m_map) {
+		if (!arch->empty()) { ret.m_archetypes.push_back({arch->id(), arch, arch->freeze()}); }
+	}
+	ret.m_records = m_records;
+	ret.m_next_id = m_next_id.load();
+	ret.m_registry_id = m_id;
+	return ret;
+}
+
+inline bool registry::restore(snapshot const& snap) {
+	auto const guard = lock();
+	if (!snap.valid() || snap.m_registry_id != m_id) { return false; }
+	++m_epoch;
+	for (auto const& [_, arch] : m_map.m_map) { arch->clear(); }
+	m_records = snap.m_records;
+	for (auto const& frozen : snap.m_archetypes) {
+		detail::archetype& arch = m_map.get_or_make(frozen.id.types);
+		arch.thaw(frozen.frozen);
+		if (&arch != frozen.arch) {
+			// archetype was recreated (eg after clear()), re-point its records
+			for (auto const e : arch.entities()) { m_records.get_mut(e.id).arch = &arch; }
+		}
+	}
+	m_next_id.store(snap.m_next_id);
+	return true;
+}
+
 template <Component T>
-T& registry::attach(entity e, T t) {
+T& registry::do_attach(entity e, T t) {
 	assert(e.id > entity::null_id && e.registry_id == m_id);
 	m_map.register_types<T>();
 	record& rec = get_or_make(e);
@@ -232,57 +952,130 @@ T& registry::attach(entity e, T t) {
 
 template <Component T>
 bool registry::attached(entity e) const {
-	if (auto it = m_records.find(e); it != m_records.end() && it->second.arch) { return it->second.arch->find<T>(); }
+	auto const guard = lock(true);
+	if (auto r = find_record(e); r && r->arch) { return r->arch->find<T>(); }
 	return false;
 }
 
 template <Component... Types>
 	requires(sizeof...(Types) > 0)
 bool registry::all_attached(entity e) const {
-	if (auto it = m_records.find(e); it != m_records.end() && it->second.arch) { return it->second.arch->has_all(detail::signs_v<Types...>); }
+	auto const guard = lock(true);
+	if (auto r = find_record(e); r && r->arch) { return r->arch->has_all(detail::signs_v<Types...>); }
 	return false;
 }
 
 template <Component... Types>
 	requires(sizeof...(Types) > 0)
 bool registry::any_attached(entity e) const {
-	if (auto it = m_records.find(e); it != m_records.end() && it->second.arch) { return it->second.arch->has_any(detail::signs_v<Types...>); }
+	auto const guard = lock(true);
+	if (auto r = find_record(e); r && r->arch) { return r->arch->has_any(detail::signs_v<Types...>); }
 	return false;
 }
 
-template <Component T>
+template <QueryComponent T>
 T* registry::find(entity e) const {
-	if (auto it = m_records.find(e); it != m_records.end() && it->second.arch) {
-		record const& r = it->second;
-		if (auto const& array = r.arch->find<T>()) { return &array->m_storage.at(r.index); }
-	}
-	return {};
+	auto const guard = query_lock<T>();
+	return do_find<T>(e);
 }
 
-template <Component T>
+template <QueryComponent T>
 T& registry::get(entity e) const {
 	assert(e.id > entity::null_id && e.registry_id == m_id);
-	auto ret = find<T>(e);
+	auto const guard = query_lock<T>();
+	auto ret = do_find<T>(e);
 	assert(ret);
 	return *ret;
 }
 
-template <Component... Types, Component... Exclude>
+template <QueryComponent T>
+T* registry::do_find(entity e) const {
+	if (auto r = find_record(e); r && r->arch && r->arch->find_base(detail::sign_t::make<std::remove_const_t<T>>())) {
+		return &r->arch->element<T>(r->index);
+	}
+	return {};
+}
+
+template <Component T, typename Pred>
+void registry::sort(Pred pred) {
+	auto const guard = lock();
+	std::vector<std::size_t> order;
+	for (auto const& [_, arch] : m_map.m_map) {
+		if (auto const array = arch->template find<T>()) {
+			auto const& storage = std::as_const(array->m_storage);
+			sort_rows(*arch, std::span<T const>(storage.data(), storage.size()), pred, order);
+		}
+	}
+}
+
+template <Component... Types, typename Pred>
+void registry::sort_entities(Pred pred) {
+	auto const guard = lock();
+	std::vector<std::size_t> order;
+	for (auto const& [_, arch] : m_map.m_map) {
+		if constexpr (sizeof...(Types) > 0) {
+			if (!arch->has_all(detail::signs_v<Types...>)) { continue; }
+		}
+		sort_rows(*arch, arch->entities(), pred, order);
+	}
+}
+
+template <QueryComponent... Types, Component... Exclude>
 std::vector<entity_view<Types...>> registry::view(exclude<Exclude...>) const {
+	auto const guard = query_lock<Types...>();
 	std::vector<entity_view<Types...>> ret;
 	for (auto const& [_, arch] : m_map.m_map) {
-		if (arch.has_all(detail::signs_v<Types...>) && !arch.has_any(exclude<Exclude...>::signs)) { append(ret, arch); }
+		if (query<include<Types...>, exclude<Exclude...>>::match(arch->id().types)) {
+			m_map.count(&structural_counters::view_matches);
+			append(ret, *arch);
+		}
 	}
 	return ret;
 }
 
-inline registry::record& registry::get_or_make(entity e) {
-	auto it = m_records.find(e);
-	if (it == m_records.end()) {
-		auto [i, _] = m_records.emplace(e, record{});
-		it = i;
+template <typename... Types, typename F, Component... Exclude>
+	requires(detail::has_required_v<Types...> && std::invocable<F&, std::span<entity const>, std::span<detail::query_element_t<Types>>...>)
+void registry::each_chunk(F f, exclude<Exclude...>) const {
+	auto const guard = query_lock<Types...>();
+	using query_t = query<detail::query_clause_t<Types>..., exclude<Exclude...>>;
+	for (auto const& [_, arch] : m_map.m_map) {
+		if (!arch->empty() && query_t::match(arch->id().types)) {
+			m_map.count(&structural_counters::view_matches);
+			f(arch->entities(), query_span<Types>(*arch)...);
+		}
 	}
-	return it->second;
+}
+
+template <typename... Clauses>
+auto registry::view(query<Clauses...>) const {
+	using query_t = query<Clauses...>;
+	static_assert(std::is_same_v<typename query_t::args_t, typename query_t::include_t>, "view() does not support maybe<T>");
+	return [this]<typename... Types, typename... Exclude>(detail::type_list<Types...>, exclude<Exclude...> ex) {
+		return view<Types...>(ex);
+	}(typename query_t::include_t{}, typename query_t::exclude_t{});
+}
+
+template <typename... Clauses, typename F>
+void registry::each_chunk(query<Clauses...>, F f) const {
+	using query_t = query<Clauses...>;
+	[this, &f]<typename... Types, typename... Exclude>(detail::type_list<Types...>, exclude<Exclude...> ex) {
+		each_chunk<Types...>(std::move(f), ex);
+	}(typename query_t::args_t{}, typename query_t::exclude_t{});
+}
+
+template <typename... Clauses, typename F>
+void registry::each(query<Clauses...>, F f) const {
+	using query_t = query<Clauses...>;
+	[this, &f]<typename... Types, typename... Exclude>(detail::type_list<Types...>, exclude<Exclude...> ex) {
+		each<Types...>(std::move(f), ex);
+	}(typename query_t::args_t{}, typename query_t::exclude_t{});
+}
+
+inline registry::record& registry::get_or_make(entity e) {
+	assert(e.registry_id == m_id && e.id <= m_next_id.load());
+	auto [ret, inserted] = m_records.emplace(e.id, record{});
+	if (inserted) { ret->name = make_name(e.id); }
+	return *ret;
 }
 
 template <typename T>
@@ -294,49 +1087,186 @@ void registry::emplace_back(record& r, detail::archetype& arch) {
 }
 
 inline void registry::migrate_to(record& out_record, detail::archetype* out_arch) {
-	send_to_back(out_record);
-	[[maybe_unused]] auto popped = out_record.arch->migrate_back(out_arch);
-	assert(&m_records[popped] == &out_record);
-	out_record.arch = out_arch;
-	// record.index = out_arch.size(); must be done by caller
-}
-
-inline void registry::send_to_back(record& r) {
-	if (!r.arch->is_last(r.index)) {
-		// swap with last
-		entity displaced = r.arch->swap_back(r.index);
-		// reindex displaced
-		assert(m_records[displaced].arch == r.arch);
-		m_records[displaced].index = r.index;
+	auto& arch = *out_record.arch;
+	m_map.count(&structural_counters::migrations);
+	if (out_arch) { m_map.count(&structural_counters::elements_moved, std::min(arch.arrays().size(), out_arch->arrays().size())); }
+	entity const displaced = arch.migrate(out_record.index, out_arch);
+	if (displaced.id != entity::null_id) {
+		// reindex displaced (last row moved into the hole)
+		m_map.count(&structural_counters::swaps);
+		m_map.count(&structural_counters::elements_moved, arch.arrays().size());
+		record& rec = m_records.get_mut(displaced.id);
+		assert(rec.arch == &arch);
+		rec.index = out_record.index;
 	}
+	out_record.arch = out_arch;
+	// record.index = out_arch.size() - 1; must be done by caller
 }
 
 template <typename T>
 bool registry::do_detach(entity e) {
-	if (e.registry_id != m_id) { return false; }
-	auto it = m_records.find(e);
-	if (it == m_records.end() || !it->second.arch) { return false; }
-	record& rec = it->second;
-	if (!rec.arch->is_last(rec.index)) {
-		auto swapped = rec.arch->swap_back(rec.index);
-		m_records[swapped].index = rec.index;
-	}
+	auto r = find_record(e);
+	if (!r || !r->arch || !r->arch->find<T>()) { return false; }
+	record& rec = *r;
 	if (rec.arch->id().types.size() == 1) {
-		rec.arch->pop_back();
-		rec = {};
+		migrate_to(rec, nullptr);
+		rec.index = {};
 	} else {
 		auto id = rec.arch->id().make(detail::sign_t::make<T>());
 		assert(id != rec.arch->id());
 		detail::archetype& target = m_map.get_or_make(id.types);
-		[[maybe_unused]] entity migrated = rec.arch->migrate_back(&target);
-		assert(&m_records[migrated] == &rec);
-		rec.arch = &target;
+		migrate_to(rec, &target);
 		assert(!target.empty());
 		rec.index = target.size() - 1;
 	}
 	return true;
 }
 
+inline void registry::migrate_tail(detail::archetype& arch, std::size_t first, detail::archetype* target) {
+	auto const count = arch.size() - first;
+	m_map.count(&structural_counters::migrations, count);
+	if (!target) {
+		for (auto const e : arch.entities().subspan(first)) {
+			record& rec = m_records.get_mut(e.id);
+			rec.arch = {};
+			rec.index = {};
+		}
+		arch.migrate_tail(first, nullptr);
+		return;
+	}
+	m_map.count(&structural_counters::elements_moved, count * std::min(arch.arrays().size(), target->arrays().size()));
+	auto const offset = target->entities().size();
+	arch.migrate_tail(first, target);
+	auto const entities = target->entities();
+	for (std::size_t index = offset; index < entities.size(); ++index) {
+		record& rec = m_records.get_mut(entities[index].id);
+		rec.arch = target;
+		rec.index = index;
+	}
+}
+
+template <typename F>
+std::size_t registry::partition_rows(detail::archetype& arch, F pred) {
+	std::vector<std::size_t> order(arch.size());
+	std::iota(order.begin(), order.end(), std::size_t{});
+	auto const first = std::stable_partition(order.begin(), order.end(), [&pred](std::size_t index) { return !pred(index); });
+	auto const ret = static_cast<std::size_t>(first - order.begin());
+	if (ret == 0 || ret == order.size()) { return ret; }
+	arch.permute(order);
+	// reindex moved rows
+	auto const entities = arch.entities();
+	for (std::size_t index = 0; index < entities.size(); ++index) {
+		if (order[index] != index) { m_records.get_mut(entities[index].id).index = index; }
+	}
+	return ret;
+}
+
+template <Component T, Component... Types, typename F, Component... Exclude>
+std::size_t registry::bulk_attach(T const& t, F filter, exclude<Exclude...>) {
+	m_map.register_types<T>();
+	auto const sign = detail::sign_t::make<T>();
+	std::vector<detail::archetype*> sources;
+	for (auto const& [_, arch] : m_map.m_map) {
+		if (!arch->empty() && !arch->find_base(sign) && query<include<Types...>, exclude<Exclude...>>::match(arch->id().types)) {
+			sources.push_back(arch);
+		}
+	}
+	std::size_t ret{};
+	for (auto* arch : sources) {
+		auto const first = filter(*arch);
+		if (first == arch->size()) { continue; }
+		detail::archetype& target = m_map.copy_append<T>(*arch);
+		auto& storage = target.get<T>().m_storage;
+		ret += arch->size() - first;
+		migrate_tail(*arch, first, &target);
+		while (storage.size() < target.entities().size()) { storage.push_back(t); }
+	}
+	return ret;
+}
+
+template <Component T, Component... Types, typename F, Component... Exclude>
+std::size_t registry::bulk_detach(F filter, exclude<Exclude...>) {
+	std::vector<detail::archetype*> sources;
+	for (auto const& [_, arch] : m_map.m_map) {
+		if (!arch->empty() && query<include<T, Types...>, exclude<Exclude...>>::match(arch->id().types)) { sources.push_back(arch); }
+	}
+	std::size_t ret{};
+	for (auto* arch : sources) {
+		auto const first = filter(*arch);
+		if (first == arch->size()) { continue; }
+		auto const id = arch->id().make(detail::sign_t::make<T>());
+		auto target = id.types.empty() ? nullptr : &m_map.get_or_make(id.types);
+		ret += arch->size() - first;
+		migrate_tail(*arch, first, target);
+	}
+	if (ret > 0) { on_removed(); }
+	return ret;
+}
+
+template <Component T, Component... Types, Component... Exclude>
+	requires(sizeof...(Types) > 0 && std::copy_constructible<T>)
+std::size_t registry::attach_all(exclude<Exclude...>, T const& t) {
+	auto const guard = lock();
+	return bulk_attach<T, Types...>(t, [](detail::archetype const&) { return std::size_t{}; }, exclude<Exclude...>{});
+}
+
+template <Component T, Component... Types, typename Pred, Component... Exclude>
+	requires(sizeof...(Types) > 0 && std::copy_constructible<T>)
+std::size_t registry::attach_if(Pred pred, exclude<Exclude...>, T const& t) {
+	auto const guard = lock();
+	auto const filter = [this, &pred](detail::archetype& arch) {
+		return partition_rows(arch, [&arch, &pred](std::size_t index) { return static_cast<bool>(pred(arch.at<Types...>(index))); });
+	};
+	return bulk_attach<T, Types...>(t, filter, exclude<Exclude...>{});
+}
+
+template <Component T, Component... Types, Component... Exclude>
+std::size_t registry::detach_all(exclude<Exclude...>) {
+	auto const guard = lock();
+	return bulk_detach<T, Types...>([](detail::archetype const&) { return std::size_t{}; }, exclude<Exclude...>{});
+}
+
+template <Component T, Component... Types, typename Pred, Component... Exclude>
+std::size_t registry::detach_if(Pred pred, exclude<Exclude...>) {
+	auto const guard = lock();
+	auto const filter = [this, &pred](detail::archetype& arch) {
+		return partition_rows(arch, [&arch, &pred](std::size_t index) { return static_cast<bool>(pred(arch.at<T, Types...>(index))); });
+	};
+	return bulk_detach<T, Types...>(filter, exclude<Exclude...>{});
+}
+
+template <typename T, typename Pred>
+void registry::sort_rows(detail::archetype& arch, std::span<T const> keys, Pred& pred, std::vector<std::size_t>& order) {
+	if (keys.size() < 2 || std::is_sorted(keys.begin(), keys.end(), pred)) { return; }
+	order.resize(keys.size());
+	std::iota(order.begin(), order.end(), std::size_t{});
+	std::sort(order.begin(), order.end(), [&keys, &pred](std::size_t l, std::size_t r) { return pred(keys[l], keys[r]); });
+	arch.permute(order);
+	// reindex all rows
+	auto const entities = arch.entities();
+	for (std::size_t index = 0; index < entities.size(); ++index) { m_records.get_mut(entities[index].id).index = index; }
+}
+
+template <typename... Types, typename F>
+void registry::each_row(F& f, std::span<entity const> entities, detail::query_element_t<Types>*... columns) {
+	for (std::size_t i = 0; i < entities.size(); ++i) {
+		if constexpr (std::invocable<F&, entity, detail::query_ref_t<Types>...>) {
+			f(entities[i], detail::query_row<Types>(columns, i)...);
+		} else {
+			f(detail::query_row<Types>(columns, i)...);
+		}
+	}
+}
+
+template <typename T>
+std::span<detail::query_element_t<T>> registry::query_span(detail::archetype const& arch) {
+	using element_t = detail::query_element_t<T>;
+	if constexpr (detail::query_arg<T>::optional_v) {
+		if (!arch.find_base(detail::sign_t::make<std::remove_const_t<element_t>>())) { return {}; }
+	}
+	return arch.column_span<element_t>();
+}
+
 template <typename... T>
 void registry::append(std::vector<entity_view<T...>>& out, detail::archetype const& arch) const {
 	std::size_t const size = arch.size();
@@ -349,4 +1279,62 @@ inline std::string registry::make_name(std::size_t id) {
 	ret += std::to_string(id);
 	return ret;
 }
+
+inline bool handle::locate() const {
+	auto& loc = m_location;
+	if (loc.arch && loc.epoch == m_registry->m_epoch && loc.version == loc.arch->version()) { return true; }
+	auto const r = m_registry->find_record(m_entity);
+	if (!r || !r->arch) {
+		loc = {};
+		return false;
+	}
+	loc = {r->arch, r->index, r->arch->version(), m_registry->m_epoch};
+	m_column = {};
+	return true;
+}
+
+template <typename T>
+detail::tarray<T>* handle::column() const {
+	if (!locate()) { return {}; }
+	auto const sign = detail::sign_t::make<T>();
+	if (!m_column || !m_column->match(sign)) {
+		m_column = m_location.arch->find_base(sign);
+		if (!m_column) { return {}; }
+	}
+	return static_cast<detail::tarray<T>*>(m_column);
+}
+
+inline bool handle::has_components() const {
+	if (!m_registry) { return false; }
+	auto const guard = m_registry->lock(true);
+	return locate();
+}
+
+template <Component T>
+bool handle::attached() const {
+	if (!m_registry) { return false; }
+	auto const guard = m_registry->lock(true);
+	return column<T>() != nullptr;
+}
+
+template <QueryComponent T>
+T* handle::find() const {
+	if (!m_registry) { return {}; }
+	auto const guard = m_registry->query_lock<T>();
+	auto const col = column<std::remove_const_t<T>>();
+	if (!col) { return {}; }
+	// const access does not unshare (copy) a frozen column
+	if constexpr (std::is_const_v<T>) {
+		return &std::as_const(col->m_storage)[m_location.index];
+	} else {
+		return &col->m_storage[m_location.index];
+	}
+}
+
+template <QueryComponent T>
+T& handle::get() const {
+	auto ret = find<T>();
+	assert(ret);
+	return *ret;
+}
 } // namespace dens
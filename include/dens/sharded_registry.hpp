@@ -0,0 +1,193 @@
+#pragma once
+#include <dens/detail/flat_map.hpp>
+#include <dens/registry.hpp>
+#include <cassert>
+#include <string>
+#include <vector>
+
+namespace dens {
+///
+/// \brief Facade over N independent registries (shards), each with its own archetypes and records
+///
+/// Entities are partitioned across shards at creation; per-entity members are routed to the owning shard
+/// (via entity::registry_id), while queries fan out across all shards (in shard order).
+/// Structural changes on distinct shards may run concurrently (eg one thread per shard, via shard(index)).
+/// Members that touch all shards (queries, size, clear, compact) must not overlap with structural changes,
+/// unless the shards were created with sync_mode::concurrent.
+///
+class sharded_registry {
+  public:
+	explicit sharded_registry(std::size_t shards, sync_mode mode = sync_mode::none);
+
+	std::size_t shard_count() const noexcept { return m_shards.size(); }
+	registry& shard(std::size_t index) noexcept {
+		assert(index < m_shards.size());
+		return m_shards[index];
+	}
+	registry const& shard(std::size_t index) const noexcept {
+		assert(index < m_shards.size());
+		return m_shards[index];
+	}
+	///
+	/// \brief Obtain the index of the shard that created e
+	/// \returns shard_count() if e was not created by any shard
+	///
+	std::size_t shard_index(entity e) const noexcept {
+		auto const it = m_indices.find(e.registry_id);
+		return it == m_indices.end() ? m_shards.size() : it->second;
+	}
+	///
+	/// \brief Obtain the shard that created e (if any)
+	///
+	registry* owner(entity e) noexcept {
+		auto const index = shard_index(e);
+		return index < m_shards.size() ? &m_shards[index] : nullptr;
+	}
+	registry const* owner(entity e) const noexcept {
+		auto const index = shard_index(e);
+		return index < m_shards.size() ? &m_shards[index] : nullptr;
+	}
+
+	///
+	/// \brief Create a new entity in shard, optionally with Types... components attached (default constructed)
+	///
+	template <Component... Types>
+	entity make_entity(std::size_t shard, std::string name = {}) {
+		return this->shard(shard).make_entity<Types...>(std::move(name));
+	}
+	bool contains(entity e) const {
+		auto const reg = owner(e);
+		return reg && reg->contains(e);
+	}
+	bool destroy(entity e) {
+		auto const reg = owner(e);
+		return reg && reg->destroy(e);
+	}
+	std::string_view name(entity e) const {
+		auto const reg = owner(e);
+		return reg ? reg->name(e) : std::string_view();
+	}
+
+	///
+	/// \brief Attach a T to e (e must belong to a shard)
+	///
+	template <Component T>
+	T& attach(entity e, T t = T{}) {
+		auto const reg = owner(e);
+		assert(reg);
+		return reg->attach<T>(e, std::move(t));
+	}
+	template <Component T>
+	bool attached(entity e) const {
+		auto const reg = owner(e);
+		return reg && reg->attached<T>(e);
+	}
+	template <Component... Types>
+		requires(sizeof...(Types) > 0)
+	bool detach(entity e) {
+		auto const reg = owner(e);
+		return reg && reg->detach<Types...>(e);
+	}
+	template <QueryComponent T>
+	T* find(entity e) const {
+		auto const reg = owner(e);
+		return reg ? reg->find<T>(e) : nullptr;
+	}
+	template <QueryComponent T>
+	T& get(entity e) const {
+		auto ret = find<T>(e);
+		assert(ret);
+		return *ret;
+	}
+
+	///
+	/// \brief Obtain the total entity count across all shards
+	///
+	std::size_t size() const noexcept;
+	bool empty() const noexcept { return size() == 0; }
+	void clear() noexcept;
+	///
+	/// \returns total number of archetypes erased
+	///
+	std::size_t compact();
+
+	///
+	/// \brief Obtain all entities (across all shards) with Types... attached and Exclude... not attached
+	///
+	template <QueryComponent... Types, Component... Exclude>
+	std::vector<entity_view<Types...>> view(exclude<Exclude...> = exclude<>{}) const;
+	///
+	/// \brief Invoke registry::each_chunk(f) on each shard
+	///
+	template <typename... Types, typename F, Component... Exclude>
+	void each_chunk(F f, exclude<Exclude...> = exclude<>{}) const {
+		for (auto const& reg : m_shards) { reg.each_chunk<Types...>(f, exclude<Exclude...>{}); }
+	}
+	///
+	/// \brief Invoke registry::each(f) on each shard
+	///
+	template <typename... Types, typename F, Component... Exclude>
+	void each(F f, exclude<Exclude...> = exclude<>{}) const {
+		for (auto const& reg : m_shards) { reg.each<Types...>(f, exclude<Exclude...>{}); }
+	}
+	template <typename... Types, Component... Exclude, typename F>
+	void each(exclude<Exclude...> ex, F f) const {
+		each<Types...>(std::move(f), ex);
+	}
+	template <typename... Clauses>
+	auto view(query<Clauses...> q) const {
+		auto ret = m_shards.front().view(q);
+		for (std::size_t i = 1; i < m_shards.size(); ++i) {
+			for (auto const& view : m_shards[i].view(q)) { ret.push_back(view); }
+		}
+		return ret;
+	}
+	template <typename... Clauses, typename F>
+	void each_chunk(query<Clauses...> q, F f) const {
+		for (auto const& reg : m_shards) { reg.each_chunk(q, f); }
+	}
+	template <typename... Clauses, typename F>
+	void each(query<Clauses...> q, F f) const {
+		for (auto const& reg : m_shards) { reg.each(q, f); }
+	}
+
+  private:
+	std::vector<registry> m_shards;
+	detail::flat_map<std::size_t, std::size_t> m_indices; // registry ID => shard index
+};
+
+// impl
+
+inline sharded_registry::sharded_registry(std::size_t shards, sync_mode mode) {
+	assert(shards > 0);
+	m_shards.reserve(shards);
+	m_indices.reserve(shards);
+	for (std::size_t i = 0; i < shards; ++i) { m_indices[m_shards.emplace_back(mode).id()] = i; }
+}
+
+inline std::size_t sharded_registry::size() const noexcept {
+	std::size_t ret{};
+	for (auto const& reg : m_shards) { ret += reg.size(); }
+	return ret;
+}
+
+inline void sharded_registry::clear() noexcept {
+	for (auto& reg : m_shards) { reg.clear(); }
+}
+
+inline std::size_t sharded_registry::compact() {
+	std::size_t ret{};
+	for (auto& reg : m_shards) { ret += reg.compact(); }
+	return ret;
+}
+
+template <QueryComponent... Types, Component... Exclude>
+std::vector<entity_view<Types...>> sharded_registry::view(exclude<Exclude...>) const {
+	auto ret = m_shards.front().view<Types...>(exclude<Exclude...>{});
+	for (std::size_t i = 1; i < m_shards.size(); ++i) {
+		// entity_view is not assignable: push_back instead of insert
+		for (auto const& view : m_shards[i].view<Types...>(exclude<Exclude...>{})) { ret.push_back(view); }
+	}
+	return ret;
+}
+} // namespace dens
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace dens {
+///
+/// \brief Storage statistics for a single component column
+///
+struct column_stats {
+	std::size_t sign{};
+	std::string_view type_name{};
+	std::size_t size{};
+	std::size_t capacity{};
+	///
+	/// \brief Bytes reserved (capacity * sizeof(T))
+	///
+	std::size_t bytes{};
+	///
+	/// \brief Whether the column's buffer is borrowed (mapped / shared with a snapshot)
+	///
+	bool borrowed{};
+};
+
+///
+/// \brief Storage statistics for a single archetype
+///
+struct archetype_stats {
+	///
+	/// \brief Combined sign of all component types
+	///
+	std::size_t signature{};
+	std::vector<column_stats> columns{};
+	std::size_t rows{};
+	///
+	/// \brief Bytes reserved by all columns and the entity array
+	///
+	std::size_t bytes{};
+};
+
+///
+/// \brief Storage statistics for an entire registry
+///
+struct registry_stats {
+	std::vector<archetype_stats> archetypes{};
+	std::size_t entities{};
+	std::size_t empty_archetypes{};
+	///
+	/// \brief Bytes reserved by all archetypes
+	///
+	std::size_t archetype_bytes{};
+	///
+	/// \brief Bytes reserved by entity records (excluding heap allocated names)
+	///
+	std::size_t record_bytes{};
+	std::size_t record_chunks{};
+};
+
+///
+/// \brief Counts of structural events in a registry
+///
+/// Only incremented if DENS_COUNTERS is defined (CMake option DENS_COUNTERS), zero otherwise
+///
+struct structural_counters {
+	std::uint64_t archetypes_created{};
+	std::uint64_t migrations{};
+	///
+	/// \brief Last rows moved into holes left by migrations
+	///
+	std::uint64_t swaps{};
+	///
+	/// \brief Component elements relocated (per column) by migrations and swaps
+	///
+	std::uint64_t elements_moved{};
+	std::uint64_t lookups{};
+	std::uint64_t lookup_misses{};
+	///
+	/// \brief Archetypes matched by views
+	///
+	std::uint64_t view_matches{};
+};
+} // namespace dens
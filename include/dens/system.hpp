@@ -27,6 +27,10 @@ class system {
 	/// \brief Entry point: user code calls this
 	///
 	void update(registry const& reg, Data const& data);
+	///
+	/// \brief Obtain the number of completed updates
+	///
+	std::uint64_t update_count() const noexcept { return m_updates; }
 
   protected:
 	///
@@ -42,6 +46,7 @@ class system {
 
   private:
 	Data const* m_data{};
+	std::uint64_t m_updates{};
 };
 
 // impl
@@ -51,6 +56,7 @@ void system<Data>::update(registry const& reg, Data const& data) {
 	m_data = &data;
 	update(reg);
 	m_data = {};
+	++m_updates;
 }
 
 template <typename Data>
@@ -1,4 +1,7 @@
+#pragma once
+#include <dens/profiler.hpp>
 #include <dens/system.hpp>
+#include <algorithm>
 #include <type_traits>
 
 namespace dens {
@@ -42,6 +45,14 @@ class system_group : public system<Data> {
 	template <System<Data> S>
 	bool reorder(order_t order);
 
+	///
+	/// \brief Set a profiler to record timings of all system updates (including those of nested groups)
+	///
+	/// Nested groups without a profiler of their own use the profiler of the group updating them
+	///
+	void set_profiler(profiler* out) noexcept { m_profiler = out; }
+	profiler* get_profiler() const noexcept { return m_profiler; }
+
 	void clear() noexcept { m_entries.clear(); }
 	std::size_t size() const noexcept { return m_entries.size(); }
 	bool empty() const noexcept { return m_entries.empty(); }
@@ -52,9 +63,13 @@ class system_group : public system<Data> {
 	struct entry_t {
 		std::unique_ptr<system<Data>> sys;
 		order_t order{};
+		std::string_view name{};
 	};
 
-	std::unordered_map<sign_t, entry_t, sign_t::hasher> m_entries;
+	void update_entry(entry_t& entry, registry const& reg);
+
+	detail::flat_map<sign_t, entry_t, sign_t::hasher> m_entries;
+	profiler* m_profiler{};
 };
 
 // impl
@@ -64,14 +79,14 @@ template <System<Data> S, typename... Args>
 S& system_group<Data>::attach(order_t order, Args&&... args) {
 	auto s = std::make_unique<S>(std::forward<Args>(args)...);
 	auto& ret = *s;
-	m_entries.insert_or_assign(sign_t::make<S>(), entry_t{.sys = std::move(s), .order = order});
+	m_entries.insert_or_assign(sign_t::make<S>(), entry_t{.sys = std::move(s), .order = order, .name = detail::type_name<S>()});
 	return ret;
 }
 
 template <typename Data>
 template <System<Data> S>
 S* system_group<Data>::find() const noexcept {
-	if (auto it = m_entries.find(sign_t::make<S>()); it != m_entries.end()) { return static_cast<S*>(it->second.system.get()); }
+	if (auto it = m_entries.find(sign_t::make<S>()); it != m_entries.end()) { return static_cast<S*>(it->second.sys.get()); }
 	return {};
 }
 
@@ -90,8 +105,8 @@ void system_group<Data>::detach() {
 template <typename Data>
 template <System<Data> S>
 bool system_group<Data>::reorder(order_t order) {
-	if (auto s = find<S>()) {
-		s->order = order;
+	if (auto it = m_entries.find(sign_t::make<S>()); it != m_entries.end()) {
+		it->second.order = order;
 		return true;
 	}
 	return false;
@@ -100,13 +115,23 @@ bool system_group<Data>::reorder(order_t order) {
 template <typename Data>
 void system_group<Data>::update(registry const& registry) {
 	if (m_entries.size() < 2) {
-		for (auto& [_, entry] : m_entries) { entry.sys->update(registry, this->data()); }
+		for (auto& [_, entry] : m_entries) { update_entry(entry, registry); }
 		return;
 	}
 	std::vector<entry_t*> sorted;
 	sorted.reserve(m_entries.size());
 	for (auto& [_, entry] : m_entries) { sorted.push_back(&entry); }
 	std::sort(sorted.begin(), sorted.end(), [](entry_t const* l, entry_t const* r) { return l->order < r->order; });
-	for (entry_t* entry : sorted) { entry->sys->update(registry, this->data()); }
+	for (entry_t* entry : sorted) { update_entry(*entry, registry); }
+}
+
+template <typename Data>
+void system_group<Data>::update_entry(entry_t& entry, registry const& reg) {
+	if (auto out = m_profiler ? m_profiler : profiler::current()) {
+		profiler::scope scope(*out, entry.name);
+		entry.sys->update(reg, this->data());
+	} else {
+		entry.sys->update(reg, this->data());
+	}
 }
 } // namespace dens
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+
+#if !defined(DENS_COLUMN_ALIGN)
+#define DENS_COLUMN_ALIGN 64
+#endif
+
+namespace dens {
+///
+/// \brief Minimum byte alignment of component column storage (CMake option DENS_COLUMN_ALIGN)
+///
+/// Columns are aligned to the larger of this and alignof(T)
+///
+inline constexpr std::size_t column_align_v = DENS_COLUMN_ALIGN;
+static_assert(column_align_v > 0 && (column_align_v & (column_align_v - 1)) == 0, "DENS_COLUMN_ALIGN must be a power of two");
+
+///
+/// \brief Customization point: specialize to round column capacities up to a multiple of value elements (eg a SIMD width)
+///
+/// Elements between a column's size and capacity are allocated but not constructed
+///
+template <typename T>
+struct column_padding : std::integral_constant<std::size_t, 1> {};
+
+template <typename T>
+inline constexpr std::size_t column_padding_v = column_padding<T>::value;
+
+///
+/// \brief Customization point: specialize as std::true_type for types that can be relocated via memcpy
+///
+/// (A relocated object's bytes are copied to the destination and the source is not destroyed)
+/// Trivially copyable types are trivially relocatable by default
+///
+template <typename T>
+struct trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+inline constexpr bool trivially_relocatable_v = trivially_relocatable<T>::value;
+} // namespace dens
@@ -1,7 +1,24 @@
+#include <dens/archive.hpp>
+#include <dens/command_buffer.hpp>
+#include <dens/coro_system.hpp>
 #include <dens/registry.hpp>
+#include <dens/sharded_registry.hpp>
+#include <dens/system_group.hpp>
 #include <dumb_test/dtest.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
 #include <iostream>
+#include <memory>
+#include <span>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace dens;
@@ -88,3 +105,987 @@ TEST(decf_multiple) {
 	}
 	EXPECT_EQ(r1.contains(e2), false);
 }
+
+TEST(decf_archive) {
+	registry src;
+	auto e0 = src.make_entity<int, float>("e0");
+	auto e1 = src.make_entity();
+	auto e2 = src.make_entity<int>();
+	src.get<int>(e0) = 42;
+	src.get<float>(e0) = 3.0f;
+	src.attach<std::string>(e2, "hello");
+	archive ar;
+	ar.add<int>().add<float>();
+	std::stringstream str;
+	EXPECT_EQ(ar.save(src, str), false);
+	auto write = [](std::ostream& out, std::string const& s) { out << s.size() << ' ' << s; };
+	auto read = [](std::istream& in) {
+		std::size_t size{};
+		in >> size;
+		in.get();
+		std::string ret(size, '\0');
+		in.read(ret.data(), static_cast<std::streamsize>(size));
+		return ret;
+	};
+	ar.add<std::string>(write, read);
+	str = {};
+	ASSERT_EQ(ar.save(src, str), true);
+	registry dst;
+	dst.make_entity<char>();
+	ASSERT_EQ(ar.load(dst, str), true);
+	EXPECT_EQ(dst.size(), 3U);
+	EXPECT_EQ(dst.view<char>().size(), 0U);
+	EXPECT_EQ(dst.view<int>().size(), 2U);
+	entity d0{e0.id, dst.id()}, d1{e1.id, dst.id()}, d2{e2.id, dst.id()};
+	EXPECT_EQ(dst.name(d0), "e0");
+	EXPECT_EQ(dst.contains(d1), true);
+	EXPECT_EQ(dst.get<int>(d0), 42);
+	EXPECT_EQ(dst.get<float>(d0), 3.0f);
+	EXPECT_EQ(dst.get<std::string>(d2), "hello");
+	dst.detach<int>(d0);
+	EXPECT_EQ(dst.get<float>(d0), 3.0f);
+	EXPECT_NE(dst.make_entity().id, e2.id);
+	std::stringstream bad("garbage");
+	EXPECT_EQ(ar.load(dst, bad), false);
+	EXPECT_EQ(dst.empty(), true);
+}
+
+TEST(decf_archive_malformed) {
+	registry src;
+	auto e0 = src.make_entity<int, float>("e0");
+	src.get<int>(e0) = 42;
+	archive ar;
+	ar.add<int>().add<float>();
+	std::stringstream str;
+	ASSERT_EQ(ar.save(src, str), true);
+	auto const bytes = str.str();
+	// header: magic, version, column_align, next_id, record count
+	std::size_t const length_at = 32 + 8;
+	std::size_t const types_at = length_at + 8 + 2 + 8;
+	std::size_t const rows_at = types_at + 8 + 2 * 8;
+	std::size_t const columns_at = rows_at + 8 + sizeof(entity);
+	auto u64_at = [&bytes](std::size_t offset) {
+		std::uint64_t ret{};
+		std::memcpy(&ret, bytes.data() + offset, sizeof(ret));
+		return ret;
+	};
+	ASSERT_EQ(u64_at(length_at), 2U);
+	ASSERT_EQ(u64_at(rows_at), 1U);
+	auto load = [&ar](std::string data, std::size_t offset, std::uint64_t value) {
+		if (offset < data.size()) { std::memcpy(data.data() + offset, &value, sizeof(value)); }
+		registry dst;
+		dst.make_entity<char>();
+		std::stringstream in(std::move(data));
+		bool const ret = ar.load(dst, in);
+		EXPECT_EQ(dst.empty(), !ret);
+		return ret;
+	};
+	EXPECT_EQ(load(bytes, bytes.size(), 0), true);
+	for (std::size_t size : {std::size_t(4), length_at + 4, rows_at, bytes.size() - 1}) { EXPECT_EQ(load(bytes.substr(0, size), size, 0), false); }
+	EXPECT_EQ(load(bytes, length_at, std::uint64_t(1) << 62), false);
+	EXPECT_EQ(load(bytes, length_at, bytes.size()), false);
+	EXPECT_EQ(load(bytes, rows_at, std::uint64_t(1) << 62), false);
+	EXPECT_EQ(load(bytes, rows_at, 2), false);
+	EXPECT_EQ(load(bytes, types_at + 16, u64_at(types_at + 8)), false);
+	// second column repeats the first: float would be left unfilled
+	EXPECT_EQ(load(bytes, columns_at + 8 + 4, u64_at(columns_at)), false);
+}
+
+TEST(decf_archive_map) {
+	registry src;
+	for (int i = 0; i < 100; ++i) {
+		auto e = src.make_entity<int, double>();
+		src.get<int>(e) = i;
+	}
+	auto e0 = src.make_entity<int>();
+	src.get<int>(e0) = -1;
+	archive ar;
+	ar.add<int>().add<double>();
+	auto const path = "decf_archive_map.bin";
+	{
+		std::ofstream file(path, std::ios::binary);
+		ASSERT_EQ(ar.save(src, file, archive::page_size_v), true);
+	}
+	{
+		registry dst;
+		ASSERT_EQ(ar.map(dst, path), true);
+		EXPECT_EQ(dst.size(), src.size());
+		int sum{};
+		for (auto [e, c] : dst.view<int>()) { sum += std::get<int&>(c); }
+		EXPECT_EQ(sum, 4949);
+		entity d0{e0.id, dst.id()};
+		dst.get<int>(d0) = 42;
+		dst.attach<char>(dst.make_entity<int>());
+		EXPECT_EQ(dst.get<int>(d0), 42);
+		EXPECT_EQ(dst.view<int>().size(), 102U);
+		std::ifstream file(path, std::ios::binary);
+		registry copy;
+		ASSERT_EQ(ar.load(copy, file), true);
+		EXPECT_EQ(copy.get<int>(entity{e0.id, copy.id()}), -1);
+	}
+	std::remove(path);
+	registry dst;
+	EXPECT_EQ(ar.map(dst, path), false);
+}
+
+TEST(decf_snapshot) {
+	registry reg;
+	auto e0 = reg.make_entity<int, std::string>("e0");
+	auto e1 = reg.make_entity<int>();
+	reg.get<int>(e0) = 1;
+	reg.get<std::string>(e0) = "hello";
+	reg.get<int>(e1) = 2;
+	auto snap = reg.checkpoint();
+	ASSERT_EQ(snap.valid(), true);
+	EXPECT_EQ(snap.size(), 2U);
+	reg.get<int>(e0) = 10;
+	reg.get<std::string>(e0) = "world";
+	reg.destroy(e1);
+	auto e2 = reg.make_entity<float>();
+	reg.attach<char>(e0);
+	reg.rename(e0, "renamed");
+	EXPECT_EQ(reg.size(), 2U);
+	auto snap2 = reg.checkpoint();
+	ASSERT_EQ(reg.restore(snap), true);
+	EXPECT_EQ(reg.size(), 2U);
+	EXPECT_EQ(reg.contains(e1), true);
+	EXPECT_EQ(reg.contains(e2), false);
+	EXPECT_EQ(reg.name(e0), "e0");
+	EXPECT_EQ(reg.get<int>(e0), 1);
+	EXPECT_EQ(reg.get<int>(e1), 2);
+	EXPECT_EQ(reg.get<std::string>(e0), "hello");
+	EXPECT_EQ(reg.attached<char>(e0), false);
+	EXPECT_EQ(reg.view<float>().size(), 0U);
+	reg.get<int>(e1) = 3;
+	ASSERT_EQ(reg.restore(snap2), true);
+	EXPECT_EQ(reg.get<int>(e0), 10);
+	EXPECT_EQ(reg.get<std::string>(e0), "world");
+	EXPECT_EQ(reg.contains(e1), false);
+	EXPECT_EQ(reg.view<float>().size(), 1U);
+	reg.clear();
+	ASSERT_EQ(reg.restore(snap), true);
+	EXPECT_EQ(reg.get<int>(e1), 2);
+	reg.detach<int>(e0);
+	EXPECT_EQ(reg.get<std::string>(e0), "hello");
+	registry other;
+	EXPECT_EQ(other.restore(snap), false);
+	reg.attach<std::unique_ptr<int>>(e1);
+	EXPECT_EQ(reg.checkpoint().valid(), false);
+}
+
+TEST(decf_sort) {
+	registry reg;
+	std::vector<entity> entities;
+	for (int i = 0; i < 10; ++i) {
+		auto e = reg.make_entity<int, std::string>();
+		reg.get<int>(e) = (i * 7) % 10;
+		reg.get<std::string>(e) = std::to_string((i * 7) % 10);
+		entities.push_back(e);
+	}
+	auto e = reg.make_entity<int>();
+	reg.get<int>(e) = -1;
+	reg.sort<int>(std::greater<>{});
+	int prev = 10;
+	bool sorted = true;
+	for (auto v : reg.view<int, std::string>()) {
+		auto const& [i, s] = v.components;
+		if (i > prev || s != std::to_string(i)) { sorted = false; }
+		prev = i;
+	}
+	EXPECT_EQ(sorted, true);
+	for (auto const e : entities) { EXPECT_EQ(reg.get<std::string>(e), std::to_string(reg.get<int>(e))); }
+	EXPECT_EQ(reg.get<int>(e), -1);
+	reg.sort_entities<std::string>();
+	auto view = reg.view<int, std::string>();
+	ASSERT_EQ(view.size(), entities.size());
+	for (std::size_t i = 0; i < view.size(); ++i) { EXPECT_EQ(view[i].entity_, entities[i]); }
+	reg.destroy(entities[3]);
+	EXPECT_EQ(reg.get<int>(entities[4]), 8);
+}
+
+TEST(decf_stats) {
+	registry reg;
+	auto e0 = reg.make_entity<int, float>();
+	reg.make_entity<int, float>();
+	reg.make_entity();
+	reg.attach<char>(e0);
+	auto const stats = reg.stats();
+	EXPECT_EQ(stats.entities, 3U);
+	EXPECT_EQ(stats.archetypes.size(), 2U);
+	EXPECT_EQ(stats.empty_archetypes, 0U);
+	EXPECT_NE(stats.record_chunks, 0U);
+	std::size_t rows{}, bytes{}, chars{};
+	for (auto const& arch : stats.archetypes) {
+		rows += arch.rows;
+		bytes += arch.bytes;
+		for (auto const& col : arch.columns) {
+			EXPECT_EQ(col.size, arch.rows);
+			EXPECT_EQ(col.capacity >= col.size, true);
+			if (col.type_name == "char") { ++chars; }
+		}
+	}
+	EXPECT_EQ(chars, 1U);
+	EXPECT_EQ(rows, 2U);
+	EXPECT_EQ(bytes, stats.archetype_bytes);
+	reg.destroy(e0);
+	EXPECT_EQ(reg.stats().empty_archetypes, 1U);
+}
+
+TEST(decf_record_churn) {
+	registry reg;
+	// long-lived low ID entity (eg a singleton): must not pin the index of every chunk issued after it
+	auto const persistent = reg.make_entity<int>("persistent");
+	std::vector<entity> live;
+	std::size_t peak{};
+	bool bounded = true;
+	// a sliding window of 100 entities over 200k IDs: records must not grow with the max ID
+	for (int round = 0; round < 2000; ++round) {
+		for (auto const e : live) { reg.destroy(e); }
+		live.clear();
+		for (int i = 0; i < 100; ++i) { live.push_back(reg.make_entity<int>()); }
+		auto const stats = reg.stats();
+		if (round < 100) {
+			peak = std::max(peak, stats.record_bytes);
+		} else if (stats.record_bytes > peak || stats.record_chunks > 3) {
+			bounded = false;
+		}
+	}
+	EXPECT_EQ(bounded, true);
+	for (auto const e : live) { EXPECT_EQ(reg.get<int>(e), 0); }
+	for (auto const e : live) { reg.destroy(e); }
+	reg.compact();
+	EXPECT_EQ(reg.stats().record_chunks, 1U);
+	EXPECT_EQ(reg.stats().record_bytes <= peak, true);
+	EXPECT_EQ(reg.name(persistent), "persistent");
+	reg.destroy(persistent);
+	reg.compact();
+	EXPECT_EQ(reg.stats().record_chunks, 0U);
+	EXPECT_EQ(reg.stats().record_bytes, 0U);
+}
+
+TEST(decf_counters) {
+	registry reg;
+	auto e0 = reg.make_entity<int>();
+	reg.make_entity<int>();
+	reg.attach<float>(e0);
+	reg.view<int>();
+	auto const& counters = reg.counters();
+	if constexpr (detail::counters_v) {
+		EXPECT_EQ(counters.archetypes_created, 2U);
+		EXPECT_EQ(counters.lookups, 3U);
+		EXPECT_EQ(counters.lookup_misses, 2U);
+		EXPECT_EQ(counters.migrations, 1U);
+		EXPECT_EQ(counters.swaps, 1U);
+		EXPECT_EQ(counters.elements_moved, 2U);
+		EXPECT_EQ(counters.view_matches, 2U);
+	} else {
+		EXPECT_EQ(counters.lookups, 0U);
+	}
+	reg.reset_counters();
+	EXPECT_EQ(counters.migrations, 0U);
+}
+
+namespace {
+struct counter_system : system<int> {
+	int updates{};
+	void update(registry const&) override { ++updates; }
+};
+struct other_system : counter_system {};
+struct nested_group : system_group<int> {};
+} // namespace
+
+TEST(decf_profiler) {
+	registry reg;
+	trace_buffer trace(4);
+	system_group<int> root;
+	root.attach<counter_system>(1);
+	auto& nested = root.attach<nested_group>(0);
+	nested.attach<other_system>();
+	root.set_profiler(&trace);
+	root.update(reg, 0);
+	auto events = trace.events();
+	ASSERT_EQ(events.size(), 3U);
+	EXPECT_EQ(events[0].depth, 1U);
+	EXPECT_EQ(events[1].depth, 0U);
+	EXPECT_EQ(events[2].depth, 0U);
+	EXPECT_EQ(events[1].start <= events[0].start, true);
+	EXPECT_EQ(events[0].name.ends_with("::other_system"), true);
+	EXPECT_EQ(events[2].name.ends_with("::counter_system"), true);
+	static_assert(detail::type_name<int>() == "int");
+	static_assert(detail::type_name<dens::registry>() == "dens::registry");
+	EXPECT_EQ(profiler::current(), nullptr);
+	root.update(reg, 0);
+	EXPECT_EQ(trace.events().size(), 4U);
+	EXPECT_EQ(root.find<counter_system>()->updates, 2);
+	EXPECT_EQ(root.reorder<counter_system>(-1), true);
+	std::stringstream str;
+	trace.write_chrome_trace(str);
+	EXPECT_NE(str.str().find("\"traceEvents\""), std::string::npos);
+	EXPECT_NE(str.str().find("\"ph\":\"X\""), std::string::npos);
+
+	// ts / dur keep sub-microsecond resolution far from the epoch
+	trace_buffer precise(2);
+	auto const start = profiler::clock_t::now();
+	auto const later = start + std::chrono::minutes(10) + std::chrono::nanoseconds(1234);
+	precise.record({"a", start, std::chrono::nanoseconds(1234567890), {}, 0});
+	precise.record({"b", later, std::chrono::nanoseconds(1500), {}, 0});
+	str = {};
+	precise.write_chrome_trace(str);
+	auto const json = str.str();
+	auto number_after = [&json](std::string_view key, std::size_t from) {
+		auto const pos = json.find(key, from);
+		return pos == std::string::npos ? std::pair{-1.0, pos} : std::pair{std::stod(json.substr(pos + key.size())), pos + key.size()};
+	};
+	auto const [ts_a, ts_a_pos] = number_after("\"ts\":", 0);
+	auto const [dur_a, dur_a_pos] = number_after("\"dur\":", ts_a_pos);
+	auto const [ts_b, ts_b_pos] = number_after("\"ts\":", dur_a_pos);
+	auto const [dur_b, dur_b_pos] = number_after("\"dur\":", ts_b_pos);
+	EXPECT_EQ(std::abs(dur_a - 1234567.890) < 1e-6, true);
+	EXPECT_EQ(std::abs(ts_b - ts_a - 600000001.234) < 1e-3, true);
+	EXPECT_EQ(std::abs(dur_b - 1.5) < 1e-6, true);
+	EXPECT_NE(json.find("\"dur\":1234567.890"), std::string::npos);
+}
+
+TEST(decf_compact) {
+	registry reg;
+	std::vector<entity> entities;
+	for (int i = 0; i < 100; ++i) { entities.push_back(reg.make_entity<int, float>()); }
+	auto e0 = reg.make_entity<int>();
+	reg.attach<char>(e0);
+	reg.detach<char>(e0);
+	auto snap = reg.checkpoint();
+	for (std::size_t i = 1; i < entities.size(); ++i) { reg.destroy(entities[i]); }
+	reg.get<int>(entities[0]) = 42;
+	EXPECT_EQ(reg.stats().empty_archetypes, 1U);
+	EXPECT_EQ(reg.compact(), 1U);
+	auto stats = reg.stats();
+	EXPECT_EQ(stats.archetypes.size(), 2U);
+	EXPECT_EQ(stats.empty_archetypes, 0U);
+	for (auto const& arch : stats.archetypes) {
+		for (auto const& col : arch.columns) { EXPECT_EQ(col.capacity, col.size); }
+	}
+	EXPECT_EQ(reg.get<int>(entities[0]), 42);
+	ASSERT_EQ(reg.restore(snap), true);
+	EXPECT_EQ((reg.view<int, float>().size()), 100U);
+	reg.attach<char>(e0);
+	reg.set_compact_policy({.interval = 1});
+	reg.detach<char>(e0);
+	EXPECT_EQ(reg.stats().empty_archetypes, 0U);
+	EXPECT_EQ(reg.attached<int>(e0), true);
+	// failed detaches remove nothing: must not count towards the interval
+	reg.set_compact_policy({});
+	reg.destroy(reg.make_entity<double>());
+	reg.set_compact_policy({.interval = 1});
+	EXPECT_EQ(reg.detach<double>(e0), false);
+	EXPECT_EQ(reg.stats().empty_archetypes, 1U);
+}
+
+namespace {
+struct relocatable {
+	std::unique_ptr<int> value{};
+};
+} // namespace
+
+template <>
+struct dens::trivially_relocatable<relocatable> : std::true_type {};
+
+TEST(decf_relocate) {
+	static_assert(trivially_relocatable_v<relocatable> && trivially_relocatable_v<int> && !trivially_relocatable_v<std::string>);
+	registry reg;
+	std::vector<entity> entities;
+	for (int i = 0; i < 10; ++i) {
+		auto e = reg.make_entity<int, std::string>();
+		reg.get<int>(e) = i;
+		reg.get<std::string>(e) = std::to_string(i);
+		reg.attach<relocatable>(e).value = std::make_unique<int>(i);
+		entities.push_back(e);
+	}
+	// move rows from the middle and front into other archetypes
+	reg.detach<std::string>(entities[4]);
+	reg.detach<int>(entities[0]);
+	reg.destroy(entities[7]);
+	for (int i = 0; i < 10; ++i) {
+		auto const e = entities[static_cast<std::size_t>(i)];
+		if (i == 7) {
+			EXPECT_EQ(reg.contains(e), false);
+			continue;
+		}
+		auto r = reg.find<relocatable>(e);
+		ASSERT_NE(r, nullptr);
+		ASSERT_NE(r->value, nullptr);
+		EXPECT_EQ(*r->value, i);
+		EXPECT_EQ(reg.attached<int>(e), i != 0);
+		if (i != 0) { EXPECT_EQ(reg.get<int>(e), i); }
+		EXPECT_EQ(reg.attached<std::string>(e), i != 4);
+		if (i != 4) { EXPECT_EQ(reg.get<std::string>(e), std::to_string(i)); }
+	}
+	EXPECT_EQ(reg.detach<float>(entities[1]), false);
+	EXPECT_EQ(reg.attached<int>(entities[1]), true);
+}
+
+TEST(decf_bulk) {
+	registry reg;
+	std::vector<entity> entities;
+	for (int i = 0; i < 20; ++i) {
+		auto e = reg.make_entity<int>();
+		reg.get<int>(e) = i;
+		if (i % 2 == 0) { reg.attach<float>(e); }
+		if (i % 5 == 0) { reg.attach<char>(e); }
+		entities.push_back(e);
+	}
+	// int only: 1, 3, 7, 9, 11, 13, 17, 19; int, float: 2, 4, 6, 8, 12, 14, 16, 18
+	EXPECT_EQ((reg.attach_all<std::string, int>(exclude<char>(), "tag")), 16U);
+	EXPECT_EQ((reg.attach_all<std::string, int>(exclude<char>())), 0U);
+	EXPECT_EQ(reg.view<std::string>().size(), 16U);
+	for (std::size_t i = 0; i < entities.size(); ++i) {
+		auto const e = entities[i];
+		EXPECT_EQ(reg.get<int>(e), static_cast<int>(i));
+		EXPECT_EQ(reg.attached<float>(e), i % 2 == 0);
+		EXPECT_EQ(reg.attached<std::string>(e), i % 5 != 0);
+		if (i % 5 != 0) { EXPECT_EQ(reg.get<std::string>(e), "tag"); }
+	}
+	EXPECT_EQ((reg.detach_if<std::string, int>([](entity_view<std::string, int> v) { return v.get<int>() > 10; })), 8U);
+	EXPECT_EQ(reg.view<std::string>().size(), 8U);
+	EXPECT_EQ((reg.attach_if<double, int>([](entity_view<int> v) { return v.get<int>() < 4; }, exclude<float>())), 2U);
+	EXPECT_EQ(reg.attached<double>(entities[1]), true);
+	EXPECT_EQ(reg.attached<double>(entities[3]), true);
+	EXPECT_EQ(reg.attached<double>(entities[0]), false);
+	for (std::size_t i = 0; i < entities.size(); ++i) {
+		EXPECT_EQ(reg.get<int>(entities[i]), static_cast<int>(i));
+		EXPECT_EQ(reg.attached<std::string>(entities[i]), i <= 10 && i % 5 != 0);
+	}
+	EXPECT_EQ(reg.detach_all<int>(), 20U);
+	EXPECT_EQ(reg.view<int>().size(), 0U);
+	EXPECT_EQ(reg.attached<float>(entities[2]), true);
+	auto const e1 = entities[1];
+	EXPECT_EQ(reg.attached<double>(e1) && reg.attached<std::string>(e1), true);
+	EXPECT_EQ(reg.detach_all<double>(), 2U);
+	EXPECT_EQ(reg.detach_all<std::string>(), 8U);
+	EXPECT_EQ(reg.contains(e1), true);
+	EXPECT_EQ(reg.name(e1).empty(), false);
+	EXPECT_EQ(reg.attach<int>(e1), 0);
+}
+
+TEST(decf_each_chunk) {
+	registry reg;
+	for (int i = 0; i < 10; ++i) {
+		auto e = reg.make_entity<int, float>();
+		reg.get<int>(e) = i;
+		reg.get<float>(e) = 1.0f;
+		if (i % 2 == 0) { reg.attach<char>(e); }
+		if (i % 3 == 0) { reg.attach<double>(e); }
+	}
+	std::size_t chunks{}, rows{};
+	reg.each_chunk<int, float>([&](std::span<entity const> entities, std::span<int> ints, std::span<float> floats) {
+		ASSERT_EQ(entities.size(), ints.size());
+		ASSERT_EQ(entities.size(), floats.size());
+		for (std::size_t i = 0; i < ints.size(); ++i) { floats[i] += static_cast<float>(ints[i]); }
+		++chunks;
+		rows += entities.size();
+	});
+	EXPECT_EQ(chunks, 4U);
+	EXPECT_EQ(rows, 10U);
+	for (auto [e, c] : reg.view<int, float>()) {
+		auto& [i, f] = c;
+		EXPECT_EQ(f, static_cast<float>(i) + 1.0f);
+	}
+	rows = {};
+	reg.each_chunk<int>([&rows](std::span<entity const> entities, std::span<int>) { rows += entities.size(); }, exclude<char>());
+	EXPECT_EQ(rows, 5U);
+}
+
+namespace {
+struct padded {
+	float value{};
+};
+} // namespace
+
+template <>
+struct dens::column_padding<padded> : std::integral_constant<std::size_t, 8> {};
+
+TEST(decf_column_align) {
+	registry reg;
+	for (int i = 0; i < 5; ++i) { reg.make_entity<char, padded>(); }
+	reg.each_chunk<char, padded>([](std::span<entity const> entities, std::span<char> chars, std::span<padded> ps) {
+		EXPECT_EQ(reinterpret_cast<std::uintptr_t>(entities.data()) % column_align_v, 0U);
+		EXPECT_EQ(reinterpret_cast<std::uintptr_t>(chars.data()) % column_align_v, 0U);
+		EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ps.data()) % column_align_v, 0U);
+	});
+	reg.set_compact_policy({.shrink_ratio = 1});
+	reg.compact();
+	for (auto const& arch : reg.stats().archetypes) {
+		for (auto const& col : arch.columns) {
+			if (col.sign == detail::sign_t::make<padded>()) {
+				EXPECT_EQ(col.capacity, 8U);
+			} else {
+				EXPECT_EQ(col.capacity, 5U);
+			}
+		}
+	}
+}
+
+TEST(decf_each) {
+	registry reg;
+	for (int i = 0; i < 10; ++i) {
+		auto e = reg.make_entity<int, float>();
+		reg.get<int>(e) = i;
+		if (i % 2 == 0) { reg.attach<char>(e); }
+	}
+	reg.each<int, float>([](int const& i, float& f) { f = static_cast<float>(i) * 2.0f; });
+	std::size_t count{};
+	reg.each<float, int>([&](entity e, float& f, int& i) {
+		EXPECT_EQ(f, static_cast<float>(i) * 2.0f);
+		EXPECT_EQ(reg.get<int>(e), i);
+		++count;
+	});
+	EXPECT_EQ(count, 10U);
+	count = {};
+	reg.each<int>(exclude<char>(), [&count](int& i) {
+		EXPECT_EQ(i % 2, 1);
+		++count;
+	});
+	EXPECT_EQ(count, 5U);
+}
+
+TEST(decf_maybe) {
+	registry reg;
+	for (int i = 0; i < 10; ++i) {
+		auto e = reg.make_entity<int>();
+		reg.get<int>(e) = i;
+		if (i % 2 == 0) { reg.attach<float>(e) = static_cast<float>(i); }
+	}
+	reg.make_entity<float>();
+	std::size_t count{}, found{};
+	reg.each<int, maybe<float>>([&](entity e, int& i, float* f) {
+		EXPECT_EQ(f == nullptr, i % 2 == 1);
+		EXPECT_EQ(f, reg.find<float>(e));
+		if (f) {
+			EXPECT_EQ(*f, static_cast<float>(i));
+			++found;
+		}
+		++count;
+	});
+	EXPECT_EQ(count, 10U);
+	EXPECT_EQ(found, 5U);
+	count = {};
+	reg.each_chunk<maybe<float>, int>([&count](std::span<entity const> entities, std::span<float> floats, std::span<int> ints) {
+		EXPECT_EQ(ints.size(), entities.size());
+		EXPECT_EQ(floats.empty() || floats.size() == entities.size(), true);
+		++count;
+	});
+	EXPECT_EQ(count, 2U);
+}
+
+TEST(decf_const_view) {
+	registry reg;
+	for (int i = 0; i < 100; ++i) {
+		auto e = reg.make_entity<int, float>();
+		reg.get<int>(e) = i;
+		if (i % 2 == 0) { reg.attach<char>(e); }
+	}
+	auto const view = reg.view<int const, float>();
+	static_assert(std::is_same_v<decltype(view[0].get<int const>()), int const&>);
+	static_assert(std::is_same_v<decltype(reg.find<int const>(view[0])), int const*>);
+	EXPECT_EQ(view.size(), 100U);
+	EXPECT_EQ(reg.find<int const>(view[0]), reg.find<int>(view[0]));
+	EXPECT_EQ(reg.find<double const>(view[0]), nullptr);
+	auto const access = query_access::make<int const, maybe<char const>, float>();
+	EXPECT_EQ(access.reads.size(), 2U);
+	EXPECT_EQ(access.writes.size(), 1U);
+	EXPECT_EQ(access.read_only(), false);
+	EXPECT_EQ(access.conflicts(query_access::make<float const>()), true);
+	EXPECT_EQ(query_access::make<int const>().conflicts(query_access::make<char, int const>()), false);
+	// concurrent readers
+	auto const expected = 99 * 100 / 2;
+	std::vector<int> sums(4);
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < sums.size(); ++t) {
+		threads.emplace_back([&reg, &sums, t] {
+			for (auto const& v : reg.view<int const>()) { sums[t] += v.get<int const>(); }
+			reg.each<int const, maybe<char const>>([&sums, t](int const& i, char const*) { sums[t] += i; });
+		});
+	}
+	for (auto& thread : threads) { thread.join(); }
+	for (auto const sum : sums) { EXPECT_EQ(sum, 2 * expected); }
+}
+
+TEST(decf_concurrent) {
+	std::vector<std::size_t> ids(8);
+	{
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < ids.size(); ++t) {
+			threads.emplace_back([&ids, t] { ids[t] = registry().id(); });
+		}
+		for (auto& thread : threads) { thread.join(); }
+	}
+	std::sort(ids.begin(), ids.end());
+	EXPECT_EQ(std::unique(ids.begin(), ids.end()) == ids.end(), true);
+
+	registry reg(sync_mode::concurrent);
+	EXPECT_EQ(reg.mode(), sync_mode::concurrent);
+	EXPECT_EQ(registry().mode(), sync_mode::none);
+	static_assert(noexcept(reg.size()) && noexcept(reg.empty()) && noexcept(reg.clear()));
+	std::atomic<bool> done{};
+	std::size_t reads{};
+	std::thread reader([&] {
+		// each() holds the (shared) lock while visiting components, references returned by view() may dangle after structural changes
+		while (!done) {
+			reg.each<int const>([&reads](int const& i) { reads += i >= 0 ? 1 : 0; });
+		}
+	});
+	std::vector<std::thread> writers;
+	for (int t = 0; t < 4; ++t) {
+		writers.emplace_back([&reg] {
+			for (int i = 0; i < 250; ++i) {
+				auto e = reg.make_entity<int>();
+				if (i % 2 == 0) { reg.attach<float>(e); }
+				if (i % 5 == 0) { reg.destroy(e); }
+			}
+		});
+	}
+	for (auto& thread : writers) { thread.join(); }
+	done = true;
+	reader.join();
+	EXPECT_EQ(reg.size(), 800U);
+	EXPECT_EQ(reg.view<int const>().size(), 800U);
+	EXPECT_EQ((reg.view<int const, float const>().size()), 400U);
+}
+
+TEST(decf_reserve_entity) {
+	registry reg;
+	auto const e0 = reg.reserve_entity();
+	EXPECT_EQ(reg.contains(e0), false);
+	EXPECT_EQ(reg.materialize<int>(e0, "e0"), true);
+	EXPECT_EQ(reg.materialize(e0), false);
+	EXPECT_EQ(reg.name(e0), "e0");
+	EXPECT_EQ(reg.attached<int>(e0), true);
+	EXPECT_EQ(reg.materialize(registry().reserve_entity()), false);
+	auto const e1 = reg.reserve_entity();
+	reg.attach<float>(e1);
+	EXPECT_EQ(reg.contains(e1), true);
+	EXPECT_EQ(reg.name(e1).empty(), false);
+
+	std::vector<command_buffer> buffers(4);
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < buffers.size(); ++t) {
+		threads.emplace_back([&reg, &buffer = buffers[t], t] {
+			for (int i = 0; i < 100; ++i) {
+				auto const e = reg.reserve_entity();
+				buffer.make_entity<int>(e).attach(e, std::to_string(t));
+				if (i % 4 == 0) { buffer.detach<int>(e); }
+				if (i % 10 == 0) { buffer.destroy(e); }
+			}
+		});
+	}
+	for (auto& thread : threads) { thread.join(); }
+	for (auto& buffer : buffers) {
+		EXPECT_EQ(buffer.empty(), false);
+		buffer.apply(reg);
+		EXPECT_EQ(buffer.empty(), true);
+	}
+	EXPECT_EQ(reg.size(), 2U + 360U);
+	EXPECT_EQ(reg.view<std::string const>().size(), 360U);
+	EXPECT_EQ((reg.view<std::string const, int const>().size()), 280U);
+}
+
+TEST(decf_merge) {
+	registry reg;
+	auto const e0 = reg.make_entity<int>("e0");
+	reg.get<int>(e0) = -1;
+	registry other;
+	std::vector<entity> entities;
+	for (int i = 0; i < 10; ++i) {
+		auto e = other.make_entity<int>();
+		other.get<int>(e) = i;
+		if (i % 2 == 0) { other.attach<std::string>(e) = std::to_string(i); }
+		entities.push_back(e);
+	}
+	auto const bare = other.make_entity("bare");
+	auto const remap = reg.merge(std::move(other));
+	EXPECT_EQ(other.empty(), true);
+	EXPECT_EQ(reg.size(), 12U);
+	EXPECT_EQ(remap.contains(e0), false);
+	EXPECT_EQ(remap(e0), e0);
+	EXPECT_EQ(reg.get<int>(e0), -1);
+	for (std::size_t i = 0; i < entities.size(); ++i) {
+		auto const e = remap(entities[i]);
+		ASSERT_EQ(reg.contains(e), true);
+		EXPECT_NE(e, e0);
+		EXPECT_EQ(reg.get<int>(e), static_cast<int>(i));
+		EXPECT_EQ(reg.attached<std::string>(e), i % 2 == 0);
+		if (i % 2 == 0) { EXPECT_EQ(reg.get<std::string>(e), std::to_string(i)); }
+	}
+	EXPECT_EQ(reg.name(remap(bare)), "bare");
+	EXPECT_EQ(reg.attached<int>(remap(bare)), false);
+	EXPECT_EQ(reg.view<int>().size(), 11U);
+	// new entities do not collide with merged ones
+	auto const e1 = reg.make_entity<int>();
+	EXPECT_EQ(remap.contains(e1), false);
+	EXPECT_EQ(reg.destroy(remap(entities[3])), true);
+	EXPECT_EQ(reg.get<int>(remap(entities[9])), 9);
+	EXPECT_EQ(reg.view<int>().size(), 11U);
+
+	// opposing merges on concurrent registries
+	registry a(sync_mode::concurrent), b(sync_mode::concurrent);
+	for (int i = 0; i < 10; ++i) {
+		a.make_entity<int>();
+		b.make_entity<float>();
+	}
+	for (int i = 0; i < 20; ++i) {
+		std::thread t([&] { a.merge(std::move(b)); });
+		b.merge(std::move(a));
+		t.join();
+	}
+	EXPECT_EQ(a.size() + b.size(), 20U);
+}
+
+TEST(decf_clone) {
+	registry reg;
+	auto const prefab = reg.make_entity<int, std::string>();
+	reg.get<int>(prefab) = 42;
+	reg.get<std::string>(prefab) = "bullet";
+	reg.make_entity<int, std::string>();
+	for (std::size_t count : {1U, 5U, 100U}) {
+		auto const before = reg.size();
+		auto const clones = reg.clone(prefab, count);
+		ASSERT_EQ(clones.size(), count);
+		EXPECT_EQ(reg.size(), before + count);
+		for (auto const e : clones) {
+			EXPECT_NE(e, prefab);
+			EXPECT_EQ(reg.get<int>(e), 42);
+			EXPECT_EQ(reg.get<std::string>(e), "bullet");
+			EXPECT_EQ(reg.name(e).empty(), false);
+		}
+	}
+	EXPECT_EQ((reg.view<int, std::string>().size()), 108U);
+	reg.get<int>(reg.clone(prefab, 3)[1]) = 7;
+	EXPECT_EQ(reg.get<int>(prefab), 42);
+	EXPECT_EQ(reg.clone(reg.make_entity(), 2).size(), 2U);
+	auto const unique = reg.make_entity<std::unique_ptr<int>>();
+	EXPECT_EQ(reg.clone(unique, 2).empty(), true);
+	EXPECT_EQ(reg.clone(entity{}, 2).empty(), true);
+}
+
+TEST(decf_handle) {
+	registry reg;
+	std::vector<entity> entities;
+	for (int i = 0; i < 8; ++i) {
+		entities.push_back(reg.make_entity<int, float>());
+		reg.get<int>(entities.back()) = i;
+	}
+	auto const h = handle(reg, entities[2]);
+	EXPECT_EQ(h.entity(), entities[2]);
+	EXPECT_EQ(h.has_components(), true);
+	EXPECT_EQ(h.get<int>(), 2);
+	EXPECT_EQ(h.attached<float>(), true);
+	EXPECT_EQ(h.attached<char>(), false);
+	EXPECT_EQ(h.find<char>(), nullptr);
+	// appends do not invalidate the cached location
+	auto const appended = reg.make_entity<int, float>();
+	EXPECT_EQ(h.get<int>(), 2);
+	// removing a row moves another entity into its place
+	reg.destroy(entities[0]);
+	reg.attach<char>(entities[1]);
+	EXPECT_EQ(h.get<int>(), 2);
+	EXPECT_EQ(h.find<int const>(), &reg.get<int>(entities[2]));
+	reg.attach<char>(entities[2]);
+	EXPECT_EQ(h.attached<char>(), true);
+	EXPECT_EQ(h.get<int>(), 2);
+	// reordering rows
+	reg.sort<int>([](int a, int b) { return a > b; });
+	EXPECT_EQ(handle(reg, entities[7]).get<int>(), 7);
+	EXPECT_EQ(handle(reg, appended).get<int>(), 0);
+	reg.get<int>(entities[2]) = 20;
+	EXPECT_EQ(h.get<int>(), 20);
+	// erasing archetypes
+	reg.detach<char>(entities[1]);
+	reg.detach<char>(entities[2]);
+	reg.compact();
+	EXPECT_EQ(h.get<int>(), 20);
+	reg.destroy(entities[2]);
+	EXPECT_EQ(h.has_components(), false);
+	EXPECT_EQ(h.find<int>(), nullptr);
+	EXPECT_EQ(handle().find<int>(), nullptr);
+}
+
+TEST(decf_flat_map) {
+	// sequential keys collide in the low bits
+	detail::flat_map<std::size_t, std::size_t> map;
+	std::map<std::size_t, std::size_t> expected;
+	std::size_t state = 1;
+	for (std::size_t i = 0; i < 4096; ++i) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		auto const key = (state >> 40) % 512 * 64;
+		if (state % 3 == 0) {
+			EXPECT_EQ(map.erase(key), expected.erase(key) > 0);
+		} else {
+			map[key] = i;
+			expected[key] = i;
+		}
+	}
+	ASSERT_EQ(map.size(), expected.size());
+	for (auto const& [key, value] : expected) {
+		ASSERT_NE(map.find(key), map.end());
+		EXPECT_EQ(map.at(key), value);
+	}
+	for (auto it = map.begin(); it != map.end();) { it = it->first % 128 == 0 ? map.erase(it) : it + 1; }
+	for (auto const& [key, _] : expected) { EXPECT_EQ(map.contains(key), key % 128 != 0); }
+
+	// archetypes erased by compact() are recycled
+	registry reg;
+	auto const e = reg.make_entity<int>();
+	reg.attach<float>(e);
+	reg.attach<char>(e);
+	reg.detach<float>(e);
+	EXPECT_EQ(reg.compact(), 3U);
+	reg.attach<float>(e);
+	reg.detach<char>(e);
+	EXPECT_EQ(reg.get<int>(e), 0);
+	EXPECT_EQ(reg.attached<float>(e), true);
+	EXPECT_EQ((reg.view<int, float>().size()), 1U);
+	EXPECT_EQ(reg.stats().archetypes.size(), 3U);
+}
+
+TEST(decf_sharded) {
+	sharded_registry reg(4);
+	ASSERT_EQ(reg.shard_count(), 4U);
+	std::vector<std::vector<entity>> spawned(reg.shard_count());
+	std::vector<std::thread> threads;
+	for (std::size_t s = 0; s < reg.shard_count(); ++s) {
+		threads.emplace_back([&reg, &spawned, s] {
+			auto& shard = reg.shard(s);
+			for (int i = 0; i < 1000; ++i) {
+				auto const e = shard.make_entity<int>();
+				shard.get<int>(e) = i;
+				if (i % 2 == 0) { shard.attach<float>(e); }
+				if (i % 10 == 0) {
+					shard.destroy(e);
+				} else {
+					spawned[s].push_back(e);
+				}
+			}
+		});
+	}
+	for (auto& thread : threads) { thread.join(); }
+	EXPECT_EQ(reg.size(), 3600U);
+	EXPECT_EQ((reg.view<int const>().size()), 3600U);
+	EXPECT_EQ((reg.view<int, float>().size()), 1600U);
+	std::size_t count{};
+	reg.each<int>([&count](int&) { ++count; }, exclude<float>());
+	EXPECT_EQ(count, 2000U);
+	for (std::size_t s = 0; s < reg.shard_count(); ++s) {
+		auto const e = spawned[s][5];
+		EXPECT_EQ(reg.shard_index(e), s);
+		EXPECT_EQ(reg.owner(e), &reg.shard(s));
+		EXPECT_EQ(reg.get<int>(e), 6);
+		EXPECT_EQ(reg.attached<float>(e), true);
+		EXPECT_EQ(reg.detach<float>(e), true);
+		EXPECT_EQ(reg.destroy(e), true);
+		EXPECT_EQ(reg.contains(e), false);
+	}
+	EXPECT_EQ(reg.size(), 3596U);
+	auto const e = reg.make_entity<char>(2, "two");
+	EXPECT_EQ(reg.name(e), "two");
+	EXPECT_EQ(reg.shard(2).contains(e), true);
+	registry other;
+	EXPECT_EQ(reg.owner(other.make_entity<int>()), nullptr);
+	EXPECT_EQ(reg.find<int>(other.make_entity<int>()), nullptr);
+	reg.clear();
+	EXPECT_EQ(reg.empty(), true);
+}
+
+TEST(decf_query) {
+	using query_t = query<include<int, float const>, exclude<char>, maybe<std::string>>;
+	static_assert(std::is_empty_v<query_t>);
+	static_assert(query_t::required.size() == 2 && query_t::excluded.size() == 1);
+	static_assert(query_t::required[0] < query_t::required[1]);
+	static_assert(query<include<float, int>>::required == query<include<int, float>>::required);
+	static_assert(query_t::match(detail::sorted_signs_v<int, float, double>));
+	static_assert(!query_t::match(detail::sorted_signs_v<int, float, char>));
+	static_assert(!query_t::match(detail::sorted_signs_v<int>));
+	static_assert(detail::sign_t::make<int>() != detail::sign_t::make<int const>());
+	EXPECT_EQ(query_t::access().read_only(), false);
+	EXPECT_EQ((query<include<int const>>::access().conflicts(query_access::make<float>())), false);
+
+	registry reg;
+	for (int i = 0; i < 10; ++i) {
+		auto const e = reg.make_entity<float, int>();
+		reg.get<int>(e) = i;
+		if (i % 2 == 0) { reg.attach<std::string>(e, std::to_string(i)); }
+		if (i % 5 == 0) { reg.attach<char>(e); }
+	}
+	reg.make_entity<int>();
+	query_t const q;
+	std::size_t count{}, found{};
+	reg.each(q, [&](entity e, int& i, float const&, std::string* str) {
+		EXPECT_EQ(reg.attached<char>(e), false);
+		EXPECT_EQ(str == nullptr, i % 2 == 1);
+		if (str) {
+			EXPECT_EQ(*str, std::to_string(i));
+			++found;
+		}
+		++count;
+	});
+	EXPECT_EQ(count, 8U);
+	EXPECT_EQ(found, 4U);
+	count = {};
+	reg.each_chunk(q, [&count](std::span<entity const> entities, std::span<int>, std::span<float const>, std::span<std::string>) { count += entities.size(); });
+	EXPECT_EQ(count, 8U);
+	EXPECT_EQ(reg.view(query<include<int>, exclude<float>>{}).size(), 1U);
+	EXPECT_EQ((reg.view(query<include<float const>, include<int>>{}).size()), 10U);
+	EXPECT_EQ((reg.view<int, float>(exclude<char>()).size()), 8U);
+}
+
+namespace {
+struct planner_system : coro_system<int> {
+	std::vector<int> log{};
+	command_buffer* buffer{};
+	counter_system const* counter{};
+
+	system_task run(registry const& reg) override {
+		log.push_back(data());
+		co_await next_frame();
+		log.push_back(data());
+		co_await wait_frames(2);
+		log.push_back(data());
+		// counter is ordered before this system: resumes within the next frame
+		co_await wait_for(*counter);
+		log.push_back(data());
+		co_await wait_until([&reg] { return reg.size() > 0; });
+		log.push_back(data());
+		co_await wait_flushed(*buffer);
+		log.push_back(data());
+	}
+};
+} // namespace
+
+TEST(decf_coro_system) {
+	registry reg;
+	command_buffer buffer;
+	system_group<int> group;
+	auto& counter = group.attach<counter_system>(-1);
+	auto& planner = group.attach<planner_system>();
+	planner.buffer = &buffer;
+	planner.counter = &counter;
+	buffer.make_entity<int>(reg.reserve_entity());
+	for (int frame = 0; frame < 6; ++frame) { group.update(reg, frame); }
+	// frame 0: start; 1: next_frame; 3: wait_frames(2); 4: wait_for; then waits for an entity
+	EXPECT_EQ(planner.log, (std::vector<int>{0, 1, 3, 4}));
+	EXPECT_EQ(planner.running(), true);
+	EXPECT_EQ(planner.update_count(), 6U);
+	reg.make_entity();
+	group.update(reg, 6);
+	group.update(reg, 7);
+	EXPECT_EQ(planner.log.size(), 5U);
+	buffer.apply(reg);
+	group.update(reg, 8);
+	EXPECT_EQ(planner.log, (std::vector<int>{0, 1, 3, 4, 6, 8}));
+	EXPECT_EQ(planner.running(), false);
+	// next update starts a new run
+	group.update(reg, 9);
+	EXPECT_EQ(planner.log.back(), 9);
+	EXPECT_EQ(planner.running(), true);
+	planner.restart();
+	EXPECT_EQ(planner.running(), false);
+	EXPECT_EQ(counter.updates, 10);
+}